@@ -0,0 +1,211 @@
+//renders a fly-through along a camera path, one bmp per frame
+//build : g++ -O2 -std=c++11 -pthread animate.cpp -o animate
+//usage : animate -path camera_path.txt [-frames n] [-scene scene.txt] [-o frame_%04d.bmp] [-size w h] [-threads n]
+//                [-stats stats.json] [-wavefront] [-packets] [-aa samples] [-aathreshold t]
+//
+//the scene is loaded and its BVH built once for all frames. frames go through
+//a two stage pipeline: while the pool traces frame k, a writer thread encodes
+//and saves frame k - 1, a small ring of frame buffers is recycled between them.
+//without -frames every key of the path is one frame, with it the keys are
+//blended into n evenly spaced frames. keys can be recorded with the 7 key of
+//the opengl viewer
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<math.h>
+
+#define HEADLESS
+
+#include "render.hpp"
+#include "camera_path.hpp"
+
+using namespace std;
+
+//frame buffers in flight, one being traced and the rest waiting for the writer
+#define pipelineDepth 3
+
+struct FramePipeline
+{
+    FrameBuffer buffers[pipelineDepth];
+    deque<int> freeBuffers;
+    deque< pair<int, int> > readyFrames;    //frame number, buffer
+    bool finished;
+    mutex lock;
+    condition_variable changed;
+
+    FramePipeline()
+    {
+        for (int b = 0; b < pipelineDepth; b++) freeBuffers.push_back(b);
+        finished = false;
+    }
+
+    int takeFree()
+    {
+        unique_lock<mutex> guard(lock);
+        while (freeBuffers.empty()) changed.wait(guard);
+
+        int b = freeBuffers.front();
+        freeBuffers.pop_front();
+        return b;
+    }
+
+    void giveBack(int b)
+    {
+        lock_guard<mutex> guard(lock);
+        freeBuffers.push_back(b);
+        changed.notify_all();
+    }
+
+    void ready(int frame, int b)
+    {
+        lock_guard<mutex> guard(lock);
+        readyFrames.push_back(make_pair(frame, b));
+        changed.notify_all();
+    }
+
+    void finish()
+    {
+        lock_guard<mutex> guard(lock);
+        finished = true;
+        changed.notify_all();
+    }
+
+    //false once every frame is written
+    bool takeReady(int& frame, int& b)
+    {
+        unique_lock<mutex> guard(lock);
+        while (readyFrames.empty() && !finished) changed.wait(guard);
+        if (readyFrames.empty()) return false;
+
+        frame = readyFrames.front().first;
+        b = readyFrames.front().second;
+        readyFrames.pop_front();
+        return true;
+    }
+};
+
+string frameName(const string& pattern, int frame)
+{
+    char name[1024];
+    snprintf(name, sizeof(name), pattern.c_str(), frame);
+    return name;
+}
+
+void usage(const char* name)
+{
+    cout << "usage: " << name << " -path camera_path.txt [-frames n] [-scene scene.txt] [-o frame_%04d.bmp] [-size w h]"
+         << " [-threads n] [-stats stats.json] [-wavefront] [-packets] [-aa samples] [-aathreshold t]" << endl;
+}
+
+int main(int argc, char **argv){
+
+    string pathFile;
+    string sceneFile = "scene.txt";
+    string pattern = "frame_%04d.bmp";
+    int frames = 0;
+    int width = 0, height = 0;
+
+    statsFile = "";
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool ok = true;
+
+        if (arg == "-path" && i + 1 < argc) {
+            pathFile = argv[++i];
+        } else if (arg == "-frames" && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (arg == "-scene" && i + 1 < argc) {
+            sceneFile = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            pattern = argv[++i];
+        } else if (arg == "-size" && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (arg == "-stats" && i + 1 < argc) {
+            statsFile = argv[++i];
+        } else if (arg == "-wavefront") {
+            wavefront = true;
+        } else if (arg == "-packets") {
+            packets = true;
+        } else if (arg == "-aa" && i + 1 < argc) {
+            aaSamples = max(1, atoi(argv[++i]));
+        } else if (arg == "-aathreshold" && i + 1 < argc) {
+            aaThreshold = atof(argv[++i]);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    vector<CameraKey> keys;
+    if (pathFile.empty() || !readCameraPath(pathFile, keys)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (frames <= 0) frames = keys.size();
+
+    double start = wallTime();
+
+    //static geometry, loaded and built once for every frame
+    if (!loadActualData(sceneFile)) {
+        return 1;
+    }
+    if (width > 0 && height > 0) {
+        imageWidth = width;
+        imageHeight = height;
+    }
+
+    FramePipeline pipeline;
+    double renderTime = 0, saveTime = 0;
+
+    thread writer([&]() {
+        int frame, b;
+        while (pipeline.takeReady(frame, b)) {
+            double saveStart = wallTime();
+            saveFrameBuffer(pipeline.buffers[b], frameName(pattern, frame));
+            saveTime += wallTime() - saveStart;
+
+            pipeline.giveBack(b);
+        }
+    });
+
+    totalStats = RenderStats();
+
+    for (int frame = 0; frame < frames; frame++) {
+        CameraKey camera = keys.size() == frames ? keys[frame] : cameraAt(keys, frames > 1 ? frame / (frames - 1.0) : 0);
+
+        int b = pipeline.takeFree();
+
+        double renderStart = wallTime();
+        swap(frameBuffer, pipeline.buffers[b]);
+        renderToFrameBuffer(camera.pos, camera.u, camera.r, camera.l);
+        swap(frameBuffer, pipeline.buffers[b]);
+        renderTime += wallTime() - renderStart;
+
+        cout << " frame " << frame << endl;
+        pipeline.ready(frame, b);
+    }
+
+    pipeline.finish();
+    writer.join();
+
+    double total = wallTime() - start;
+
+    renderTimes.render = renderTime;
+    renderTimes.save = saveTime;
+    writeStats(activeCrop().width, activeCrop().height, numberOfThreads());
+
+    cout << frames << " frames in " << total << " s, " << frames / total << " frames/s"
+         << " (load " << renderTimes.load << " s, build " << renderTimes.build << " s, render " << renderTime
+         << " s, save " << saveTime << " s, saving overlapped with rendering)" << endl;
+
+    freeMemory();
+    return 0;
+}
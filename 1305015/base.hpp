@@ -1,8 +1,16 @@
 #ifndef BASE_H
 #define BASE_H
 
+#ifndef HEADLESS
 #include "drawing_code.hpp"
+#else
+#include "point.hpp"
+#define pi (2*acos(0.0))
+#endif
 #include "bitmap_image.hpp"
+#include "texture_cache.hpp"
+#include "packet.hpp"
+#include "stats.hpp"
 #include <bits/stdc++.h>
 using namespace std;
 
@@ -11,6 +19,29 @@ extern int recursion_level;
 extern double dotProduct(point a, point b);
 extern point crossProduct(point a, point b);
 
+struct object;
+
+//everything the shading needs about a ray hit, filled once by the intersection stage
+struct Hit
+{
+    double t;
+    object* obj;
+    point position;
+    point normal;
+    double u, v;    //surface coordinates of the hit, filled only by textured objects
+    double footprint;   //width of the pixel on the surface, filled by textured objects
+};
+
+//angle between neighbouring camera rays, set by the renderer. the footprint
+//of a pixel grows by that much per unit of path length
+double pixelSpread = 0;
+
+extern vector<object*> objects;
+extern vector<point> lights; //actually not point, vector
+
+extern bool nearestHit(Ray* ray, Hit& hit);
+extern bool occluded(Ray* ray, double len, int light);
+
 struct object
 {
     point reference_point;
@@ -20,11 +51,36 @@ struct object
 	double co_efficients[4];
 	double source_factor = 1.0;
 	double refracting_index = 1.5;
+	bool pooled = false;           //lives in one of the object blocks of scene.hpp, not on its own
 
 	object(){ }
+	virtual ~object(){ }
 	virtual void draw(){}
-	virtual double intersect(Ray* r, double current_color[3], int level){}
-	virtual double getIntersectionT(Ray* ray){}
+	//caches everything the per ray tests can work out ahead, called once the
+	//object is fully set up and again whenever its geometry changes
+	virtual void compile(){}
+	virtual double getIntersectionT(Ray* ray){ return -1; }
+	//closest hit test for every active lane of a camera ray packet,
+	//index is the object's position in objects
+	virtual void intersectPacket(RayPacket& packet, int index)
+	{
+	    for (int k = 0; k < packetSize; k++) {
+	        if (packet.active[k]) packet.record(k, getIntersectionT(&packet.rays[k]), index);
+	    }
+	}
+	//completes a hit whose t and obj are set: position, normal, surface coordinates
+	virtual void fillHit(Ray* ray, Hit& hit){}
+	//diffuse color at the hit into surfaceColor, its ambient part into current_color
+	virtual void getSurfaceColor(Hit& hit, double surfaceColor[3], double current_color[3]){}
+	virtual bool refracts(){ return false; }
+	//box around the object, false if it is unbounded
+	virtual bool getBounds(AABB& box){ return false; }
+	//any hit test for shadow rays, true if the object is hit with 0 < t <= len
+	virtual bool hitsWithin(Ray* ray, double len)
+	{
+	    double t = getIntersectionT(ray);
+	    return t > 0 && t <= len;
+	}
 
 	point getReflection(Ray* ray, point normal) {
 	    const double cosI = dotProduct(ray->dir, normal);
@@ -34,7 +90,7 @@ struct object
     }
     point getRefraction(Ray* ray, point normal) {
         const double cosI = -dotProduct(normal, ray->dir);
-        const double sinT2 = refracting_index * refracting_index * ( 1.0 - sinT2 );
+        const double sinT2 = refracting_index * refracting_index * ( 1.0 - cosI * cosI );
         if(sinT2 > 1.0)
             return {0,0,0};
         const double cosT = sqrt(1.0 - sinT2);
@@ -67,68 +123,153 @@ struct object
             }
         }
     }
-    int getNearestPoint(Ray ray, vector<object*>& objects)
+    bool getNearestHit(Ray ray, Hit& hit)
     {
-        int nearest=-1;
-        double minT = 9999999;
+        return nearestHit(&ray, hit);
+    }
 
-        for (int k=0; k < objects.size(); k++) {
+    bool ifHasObstacle(Ray L, double len, int light)
+    {
+        return occluded(&L, len, light);
+    }
 
-            double tk = objects[k]->getIntersectionT(&ray);
+    //ray from the hit towards a light, len is the distance to the light
+    Ray getShadowRay(point intersectionPoint, int light, double& len)
+    {
+        point dir = lights[light] - intersectionPoint;
+        len = sqrt(dir.x*dir.x + dir.y*dir.y + dir.z*dir.z);
+        dir.normalize();
 
-            if(tk <= 0) {
-                continue;
-            } else if (tk < minT) {
-                minT = tk;
-                nearest = k;
-            }
+        point start = intersectionPoint + dir*1.0;
+        return Ray(start, dir);
+    }
+
+    //diffuse and specular light arriving along an unblocked shadow ray L
+    void addLight(Ray* ray, Ray& L, point normal, point reflection, double* surfaceColor, double* current_color)
+    {
+        double lambert = dotProduct(L.dir, normal);
+        double temp = dotProduct(reflection, ray->dir);
+        double phong = pow(temp, shine);
 
-            //cout<<tk<<endl;
+        if(lambert < 0) lambert = 0;
+        if(phong < 0) phong = 0;
+
+        for (int k=0; k<3; k++) {
+            current_color[k] += source_factor * lambert * co_efficients[1] * surfaceColor[k];
+            current_color[k] += source_factor * phong * co_efficients[2] * surfaceColor[k];
         }
-        return nearest;
     }
 
-    bool ifHasObstacle(Ray L, vector<object*>& objects, double len)
+    //a zero refraction direction means total internal reflection, nothing to trace
+    bool hasRefraction(point refraction)
     {
-        bool hasObstacle = false;
+        return refracts() && (refraction.x != 0 || refraction.y != 0 || refraction.z != 0);
+    }
+
+    //color seen at the hit: ambient and direct light from every source, then
+    //one reflected and, for refracting objects, one refracted ray
+    void shade(Ray* ray, Hit& hit, double current_color[3], int level)
+    {
+        double surfaceColor[3];
+        getSurfaceColor(hit, surfaceColor, current_color);
+
+        point intersectionPoint = hit.position;
+        point normal = hit.normal;
+
+        point reflection = getReflection(ray, normal);
+
+        for (int i=0; i<lights.size(); i++) {
+
+            double len;
+            Ray L = getShadowRay(intersectionPoint, i, len);
+            countRay(shadowRays, level);
+
+            bool hasObstacle = ifHasObstacle(L, len, i);
+
+            if (hasObstacle == false){
+                addLight(ray, L, normal, reflection, surfaceColor, current_color);
+            }
+        }
+
+        if (level < recursion_level) {
+
+            point start = intersectionPoint + reflection * 1.0;
 
-        for (int j=0; j < objects.size(); j++) {
+            Ray reflectionRay(start, reflection, ray->travelled + hit.t);
+            countRay(reflectionRays, level+1);
 
-            double temp_intersect = objects[j]->getIntersectionT(&L);
+            double reflected_color[3];
+            Hit reflectedHit;
 
-            if(temp_intersect > 0   &&  temp_intersect <= len) {
-                hasObstacle = true;
-                break;
+            if(getNearestHit(reflectionRay, reflectedHit)) {
+
+                reflectedHit.obj->shade(&reflectionRay, reflectedHit, reflected_color, level+1);
+
+                for (int k=0; k<3; k++) {
+                    current_color[k] += reflected_color[k] * co_efficients[3];
+                }
+            }
+
+            point refraction = getRefraction(ray, normal);
+
+            if (hasRefraction(refraction)) {
+
+                start = intersectionPoint + refraction * 1.0;
+
+                Ray refractionRay(start, refraction, ray->travelled + hit.t);
+                countRay(refractionRays, level+1);
+
+                double refracted_color[3];
+                Hit refractedHit;
+
+                if(getNearestHit(refractionRay, refractedHit)) {
+
+                    refractedHit.obj->shade(&refractionRay, refractedHit, refracted_color, level+1);
+
+                    for (int k=0; k<3; k++) {
+                        current_color[k] += refracted_color[k] * refracting_index;
+                    }
+                }
             }
         }
+
+        updateColorRange(current_color);
     }
 };
 
-extern vector<object*> objects;
-extern vector<point> lights; //actually not point, vector
-
 struct sphere: object{
+    double radiusSquared;
+
     sphere(point center, double radius){
         reference_point = center;
         length = radius;
+        compile();
+    }
+
+    void compile() {
+        radiusSquared = length*length;
     }
 
     void draw(){
+#ifndef HEADLESS
         //write codes for drawing sphere
         glPushMatrix();
 
         glTranslatef(reference_point.x, reference_point.y, reference_point.z);
         drawSphere(length);
         glPopMatrix();
+#endif
     }
 
     double getIntersectionT(Ray* ray) {
 
+        countTest(spherePrimitive);
+
         point start = ray->start - reference_point;
 
         double a = 1.0;
         double b = 2 * dotProduct(ray->dir, start);
-        double c = dotProduct(start, start) - length*length;
+        double c = dotProduct(start, start) - radiusSquared;
 
         double d = b * b - 4 * a * c;
 
@@ -142,121 +283,103 @@ struct sphere: object{
         return min(t1, t2);
     }
 
-    void setColorAt(double* current_color, double* color)
-    {
-        for(int i = 0; i < 3; ++i)
-            current_color[i] = color[i] * co_efficients[0];
-    }
+    void intersectPacket(RayPacket& packet, int index) {
 
-    point getNormal(point intersection) {
-        point normal = intersection - reference_point;
-        normal.normalize();
-        return normal;
-    }
-
-    double intersect(Ray* ray, double current_color[3], int level) {
-
-        double t = getIntersectionT(ray);
-
-        if (t <= 0) return -1;
-        if (level == 0) return t;
-
-        point intersectionPoint = ray->start + ray->dir * t;
-
-        setColorAt(current_color, color);
+        countTest(spherePrimitive, packetSize);
 
-        point normal = getNormal(intersectionPoint);
+        lanes cx = vset(reference_point.x), cy = vset(reference_point.y), cz = vset(reference_point.z);
+        lanes r2 = vset(radiusSquared), zero = vset(0), two = vset(2), four = vset(4), none = vset(-1);
 
-        point reflection = getReflection(ray, normal);
-        point refraction = getRefraction(ray, normal);
+        //same arithmetic as getIntersectionT, a lane at a time
+        for (int k = 0; k < packetSize; k += simdWidth) {
+            lanes sx = vsub(vload(packet.ox + k), cx);
+            lanes sy = vsub(vload(packet.oy + k), cy);
+            lanes sz = vsub(vload(packet.oz + k), cz);
+            lanes dx = vload(packet.dx + k), dy = vload(packet.dy + k), dz = vload(packet.dz + k);
 
-        for (int i=0; i<lights.size(); i++) {
+            lanes b = vmul(two, vadd(vadd(vmul(dx, sx), vmul(dy, sy)), vmul(dz, sz)));
+            lanes c = vsub(vadd(vadd(vmul(sx, sx), vmul(sy, sy)), vmul(sz, sz)), r2);
 
-            point direction = lights[i] - intersectionPoint;
-            double len = sqrt(direction.x*direction.x + direction.y*direction.y + direction.z*direction.z);
-            direction.normalize();
+            lanes d = vsub(vmul(b, b), vmul(four, c));
+            lanes root = vsqrt(vmax(d, zero));
 
-            point start = intersectionPoint + direction * 1.0;
-            Ray L(start, direction);
-            //cout<<intersectionPoint<<L.start<<L.direction;
+            lanes t1 = vdiv(vadd(vsub(zero, b), root), two);
+            lanes t2 = vdiv(vsub(vsub(zero, b), root), two);
 
-            bool hasObstacle = ifHasObstacle(L, objects, len);
-
-            if (hasObstacle == false){
-
-                double lambert = dotProduct(L.dir, normal);
-                double temp = dotProduct(reflection, ray->dir);
-                double phong = pow(temp, shine);
-
-                if(lambert < 0) lambert = 0;
-                if(phong < 0) phong = 0;
-
-                for (int k=0; k<3; k++) {
-                    current_color[k] += source_factor * lambert * co_efficients[1] * color[k];
-                    current_color[k] += source_factor * phong * co_efficients[2] * color[k];
-                }
-            }
-
-            if (level < recursion_level) {
+            packet.recordLanes(k, vselect(vlt(d, zero), none, vmin(t1, t2)), index);
+        }
+    }
 
-                start = intersectionPoint + reflection * 1.0;
+    bool hitsWithin(Ray* ray, double len) {
 
-                Ray reflectionRay(start, reflection);
+        countTest(spherePrimitive);
 
-                double reflected_color[3];
-                int nearest = getNearestPoint(reflectionRay, objects);
+        point start = ray->start - reference_point;
 
-                if(nearest!=-1) {
+        double b = dotProduct(ray->dir, start);
+        double c = dotProduct(start, start) - radiusSquared;
 
-                    double ret = objects[nearest]->intersect(&reflectionRay, reflected_color, level+1);
-                    if(ret <= 0)
-                        continue;
+        //closest approach behind the start or beyond len + radius
+        if (b > 0 && c > 0) return false;
+        if (-b - length > len) return false;
 
-                    for (int k=0; k<3; k++) {
-                        current_color[k] += reflected_color[k] * co_efficients[3];
-                    }
-                }
+        double d = b * b - c;
+        if (d < 0) return false;
 
+        double t = - b - sqrt(d);
+        return t > 0 && t <= len;
+    }
 
-                start = intersectionPoint + refraction * 1.0;
-
-                Ray refractionRay(start, refraction);
+    bool getBounds(AABB& box) {
+        point extent(length, length, length);
+        box = AABB(reference_point - extent, reference_point + extent);
+        return true;
+    }
 
-                double refracted_color[3];
-                nearest = getNearestPoint(refractionRay, objects);
+    void setColorAt(double* current_color, double* color)
+    {
+        for(int i = 0; i < 3; ++i)
+            current_color[i] = color[i] * co_efficients[0];
+    }
 
-                if(nearest!=-1) {
+    point getNormal(point intersection) {
+        point normal = intersection - reference_point;
+        normal.normalize();
+        return normal;
+    }
 
-                    double ret = objects[nearest]->intersect(&refractionRay, refracted_color, level+1);
-                    if(ret <= 0)
-                        continue;
+    void fillHit(Ray* ray, Hit& hit) {
+        hit.position = ray->start + ray->dir * hit.t;
+        hit.normal = getNormal(hit.position);
+    }
 
-                    for (int k=0; k<3; k++) {
-                        current_color[k] += refracted_color[k] * refracting_index;
-                    }
-                }
-            }
-            updateColorRange(current_color);
-        }
+    bool refracts() {
+        return true;
+    }
 
-        return t;
+    void getSurfaceColor(Hit& hit, double surfaceColor[3], double current_color[3]) {
+        for (int k=0; k<3; k++) surfaceColor[k] = color[k];
+        setColorAt(current_color, color);
     }
 };
 
 struct Floor: object{
+    point normal;
     int numberOfTiles;
-    bitmap_image texture;
+    const MipTexture* texture;      //shared, see loadTexture
     double texture_height, texture_width;
     Floor(double FloorWidth, double TileWidth){
         reference_point = point(-FloorWidth / 2.0, -FloorWidth / 2.0, 0);
         length = TileWidth;
         numberOfTiles = FloorWidth / TileWidth;
-        texture = bitmap_image("newt.bmp");
-        texture_height = texture.height() / abs(FloorWidth);
-        texture_width = texture.width() / abs(FloorWidth);
+        texture = loadTexture("newt.bmp");
+        texture_height = texture->height() / abs(FloorWidth);
+        texture_width = texture->width() / abs(FloorWidth);
+        compile();
     }
 
     void draw(){
+#ifndef HEADLESS
         //write codes for drawing black and white floor
         for (int i = 0; i < numberOfTiles; ++i)
         {
@@ -276,127 +399,99 @@ struct Floor: object{
                 glEnd();
             }
         }
+#endif
     }
 
     point getNormal(point intersection) {
-        point normal(0,0,1);
-        normal.normalize();
         return normal;
     }
 
-    double getIntersectionT(Ray* ray) {
-
-        point normal = getNormal(reference_point);
-
-        double t = dotProduct(normal, ray->start) * (-1) / dotProduct(normal, ray->dir);
-
-        return t;
-    }
-
-    void setColorAt(double* current_color, double* color, double* rgb)
-    {
-        for(int i = 0; i < 3; ++i)
-            current_color[i] = color[i] * co_efficients[0] * rgb[i] / 255.0;
+    void compile() {
+        normal = point(0,0,1);
+        normal.normalize();
     }
 
+    double getIntersectionT(Ray* ray) {
 
-    double intersect(Ray* ray, double current_color[3], int level) {
+        countTest(floorPrimitive);
 
-        double t = getIntersectionT(ray);
+        double t = dotProduct(normal, ray->start) * (-1) / dotProduct(normal, ray->dir);
 
         point intersectionPoint = ray->start + ray->dir * t;
 
-        double xMin = reference_point.x;
-        double xMax = -xMin;
-
-        double yMin = reference_point.y;
-        double yMax = -yMin;
-
-        if (xMin > intersectionPoint.x || intersectionPoint.x > xMax ||
-                yMin > intersectionPoint.y || intersectionPoint.y > yMax) {
+        if (reference_point.x > intersectionPoint.x || intersectionPoint.x > -reference_point.x ||
+                reference_point.y > intersectionPoint.y || intersectionPoint.y > -reference_point.y) {
             return -1;
         }
 
+        return t;
+    }
 
-        int xVal = (intersectionPoint.x - reference_point.x) / length;
-        int yVal = (intersectionPoint.y - reference_point.y) / length;
-
-        if ((xVal+yVal)%2) {
-            color[0] = color[1] = color[2] = 0;
-        } else {
-            color[0] = color[1] = color[2] = 1;
-        }
-
-        unsigned char r, g, b;
-        int x = (intersectionPoint.x + abs(reference_point.x)) * texture_width;
-        int y = (intersectionPoint.y + abs(reference_point.y)) * texture_height;
-
-        //cout<<x<<','<<y<<endl;
-
-        texture.get_pixel(x, y, r, g, b);
-
-        double rgb[] = {r, g, b};
-        //cout<<rgb[0];
-
-        setColorAt(current_color, color, rgb);
-
-        point normal = getNormal(intersectionPoint);
-
-        point reflection = getReflection(ray, normal);
-        //point refraction = getRefraction(ray, normal);
+    void intersectPacket(RayPacket& packet, int index) {
 
-        for (int i=0; i<lights.size(); i++) {
+        countTest(floorPrimitive, packetSize);
 
-            point dir = lights[i] - intersectionPoint;
-            double len = sqrt(dir.x*dir.x + dir.y*dir.y + dir.z*dir.z);
-            dir.normalize();
+        lanes nx = vset(normal.x), ny = vset(normal.y), nz = vset(normal.z);
+        lanes minX = vset(reference_point.x), maxX = vset(-reference_point.x);
+        lanes minY = vset(reference_point.y), maxY = vset(-reference_point.y);
+        lanes minusOne = vset(-1);
 
-            point start = intersectionPoint + dir*1.0;
-            Ray L(start, dir);
-            //cout<<intersectionPoint<<L.start<<L.dir;
+        //same arithmetic as getIntersectionT, a lane at a time
+        for (int k = 0; k < packetSize; k += simdWidth) {
+            lanes ox = vload(packet.ox + k), oy = vload(packet.oy + k), oz = vload(packet.oz + k);
+            lanes dx = vload(packet.dx + k), dy = vload(packet.dy + k), dz = vload(packet.dz + k);
 
-            bool hasObstacle = ifHasObstacle(L, objects, len);
+            lanes facing = vadd(vadd(vmul(nx, ox), vmul(ny, oy)), vmul(nz, oz));
+            lanes t = vdiv(vmul(facing, minusOne), vadd(vadd(vmul(nx, dx), vmul(ny, dy)), vmul(nz, dz)));
 
-            if (hasObstacle == false){
+            lanes x = vadd(ox, vmul(dx, t));
+            lanes y = vadd(oy, vmul(dy, t));
 
-                double lambert = dotProduct(L.dir, normal);
-                double temp = dotProduct(reflection, ray->dir);
-                double phong = pow(temp, shine);
+            laneMask miss = vor(vor(vgt(minX, x), vgt(x, maxX)), vor(vgt(minY, y), vgt(y, maxY)));
+            packet.recordLanes(k, vselect(miss, minusOne, t), index);
+        }
+    }
 
-                if(lambert < 0) lambert = 0;
-                if(phong < 0) phong = 0;
+    void fillHit(Ray* ray, Hit& hit) {
+        hit.position = ray->start + ray->dir * hit.t;
+        hit.normal = getNormal(hit.position);
 
-                for (int k=0; k<3; k++) {
-                    current_color[k] += source_factor * lambert * co_efficients[1] * color[k];
-                    current_color[k] += source_factor * phong * co_efficients[2] * color[k];
-                }
-            }
+        //offset from the floor corner, the texture and the tiles are laid out on it
+        hit.u = hit.position.x - reference_point.x;
+        hit.v = hit.position.y - reference_point.y;
 
-            if (level < recursion_level) {
+        //the pixel cone widens along the path and stretches where it meets the floor at a slant,
+        //the geometric mean of the stretched and the unstretched width keeps distant tiles sharp
+        double slant = max(fabs(dotProduct(ray->dir, hit.normal)), 0.01);
+        hit.footprint = pixelSpread * (ray->travelled + hit.t) / sqrt(slant);
+    }
 
-                start = intersectionPoint + reflection * 1.0;
+    void setColorAt(double* current_color, double* color, double* rgb)
+    {
+        for(int i = 0; i < 3; ++i)
+            current_color[i] = color[i] * co_efficients[0] * rgb[i] / 255.0;
+    }
 
-                Ray reflectionRay(start, reflection);
 
-                double reflected_color[3];
-                int nearest = getNearestPoint(reflectionRay, objects);
+    void getSurfaceColor(Hit& hit, double tileColor[3], double current_color[3]) {
 
-                if(nearest!=-1) {
+        int xVal = hit.u / length;
+        int yVal = hit.v / length;
 
-                    double ret = objects[nearest]->intersect(&reflectionRay, reflected_color, level+1);
-                    if(ret <= 0)
-                        continue;
+        if ((xVal+yVal)%2) {
+            tileColor[0] = tileColor[1] = tileColor[2] = 0;
+        } else {
+            tileColor[0] = tileColor[1] = tileColor[2] = 1;
+        }
 
-                    for (int k=0; k<3; k++) {
-                        current_color[k] += reflected_color[k] * co_efficients[3];
-                    }
-                }
-            }
+        //filtered over the texels the pixel covers
+        double rgb[3];
+        double x = hit.u * texture_width;
+        double y = hit.v * texture_height;
 
-            updateColorRange(current_color);
-        }
+        texture->sample(x, y, hit.footprint * max(texture_width, texture_height), rgb);
 
-        return t;
+        setColorAt(current_color, tileColor, rgb);
     }
 };
 
@@ -404,10 +499,13 @@ struct Triangle: object {
 
     point a, b, c;
 
+    point edge1, edge2, normal;
+
     Triangle(point a, point b, point c) {
         this->a = a;
         this->b = b;
         this->c = c;
+        compile();
     }
 
     Triangle(point ar[3])
@@ -415,9 +513,19 @@ struct Triangle: object {
         this->a = ar[0];
         this->b = ar[1];
         this->c = ar[2];
+        compile();
+    }
+
+    void compile() {
+        edge1 = b - a;
+        edge2 = c - a;
+
+        normal = crossProduct(edge1, edge2);
+        normal.normalize();
     }
 
     void draw() {
+#ifndef HEADLESS
         glColor3f(color[0],color[1],color[2]);
         glBegin(GL_TRIANGLES);
         {
@@ -426,25 +534,18 @@ struct Triangle: object {
             glVertex3f(c.x, c.y, c.z);
         }
         glEnd();
+#endif
     }
 
     point getNormal(point intersection) {
-
-        point edge1 = b - a;
-        point edge2 = c - a;
-
-        point normal = crossProduct(edge1, edge2);
-        normal.normalize();
-
         return normal;
     }
 
     double getIntersectionT(Ray* ray) {
 
-        const float EPSILON = 0.0000001;
+        countTest(trianglePrimitive);
 
-        point edge1 = b - a;
-        point edge2 = c - a;
+        const float EPSILON = 0.0000001;
 
         point h = crossProduct(ray->dir, edge2);
         double det = dotProduct(edge1, h);
@@ -480,80 +581,72 @@ struct Triangle: object {
         return -1;
     }
 
-    void setColorAt(double* current_color, double* color)
-    {
-        for (int i=0; i<3; i++) {
-            current_color[i] = color[i] * co_efficients[0];
-        }
-    }
-
-
-    double intersect(Ray* ray, double current_color[3], int level) {
+    void intersectPacket(RayPacket& packet, int index) {
 
-        double t = getIntersectionT(ray);
+        countTest(trianglePrimitive, packetSize);
 
-        if (t <= 0) return -1;
-        if (level == 0 ) return t;
-
-        setColorAt(current_color, color);
-
-        point intersectionPoint = ray->start + ray->dir * t;
-
-        for (int i=0; i<lights.size(); i++) {
-
-            point normal = getNormal(intersectionPoint);
+        const float EPSILON = 0.0000001;
 
-            point dir = lights[i] - intersectionPoint;
-            double len = sqrt(dir.x*dir.x + dir.y*dir.y + dir.z*dir.z);
-            dir.normalize();
+        lanes e1x = vset(edge1.x), e1y = vset(edge1.y), e1z = vset(edge1.z);
+        lanes e2x = vset(edge2.x), e2y = vset(edge2.y), e2z = vset(edge2.z);
+        lanes ax = vset(a.x), ay = vset(a.y), az = vset(a.z);
+        lanes zero = vset(0), one = vset(1), none = vset(-1), epsilon = vset(EPSILON), minusEpsilon = vset(-EPSILON);
 
-            point reflection = getReflection(ray, normal);
+        //same arithmetic as getIntersectionT, a lane at a time
+        for (int k = 0; k < packetSize; k += simdWidth) {
+            lanes dx = vload(packet.dx + k), dy = vload(packet.dy + k), dz = vload(packet.dz + k);
 
-            point start = intersectionPoint + dir*1.0;
-            Ray L(start, dir);
-            //cout<<intersectionPoint<<L.start<<L.dir;
+            lanes hx = vsub(vmul(dy, e2z), vmul(dz, e2y));
+            lanes hy = vsub(vmul(dz, e2x), vmul(dx, e2z));
+            lanes hz = vsub(vmul(dx, e2y), vmul(dy, e2x));
 
-            bool hasObstacle = ifHasObstacle(L, objects, len);
+            lanes det = vadd(vadd(vmul(e1x, hx), vmul(e1y, hy)), vmul(e1z, hz));
+            lanes inv_det = vdiv(one, det);
 
-            if (hasObstacle == false){
+            lanes sx = vsub(vload(packet.ox + k), ax);
+            lanes sy = vsub(vload(packet.oy + k), ay);
+            lanes sz = vsub(vload(packet.oz + k), az);
 
-                double lambert = dotProduct(L.dir, normal);
-                double temp = dotProduct(reflection, ray->dir);
-                double phong = pow(temp, shine);
+            lanes u = vmul(vadd(vadd(vmul(sx, hx), vmul(sy, hy)), vmul(sz, hz)), inv_det);
 
-                if(lambert < 0) lambert = 0;
-                if(phong < 0) phong = 0;
+            lanes qx = vsub(vmul(sy, e1z), vmul(sz, e1y));
+            lanes qy = vsub(vmul(sz, e1x), vmul(sx, e1z));
+            lanes qz = vsub(vmul(sx, e1y), vmul(sy, e1x));
 
-                for (int k=0; k<3; k++) {
-                    current_color[k] += source_factor * lambert * co_efficients[1] * color[k];
-                    current_color[k] += source_factor * phong * co_efficients[2] * color[k];
-                }
-            }
+            lanes v = vmul(vadd(vadd(vmul(dx, qx), vmul(dy, qy)), vmul(dz, qz)), inv_det);
+            lanes t = vmul(vadd(vadd(vmul(e2x, qx), vmul(e2y, qy)), vmul(e2z, qz)), inv_det);
 
-            if (level < recursion_level) {
+            laneMask miss = vand(vgt(det, minusEpsilon), vlt(det, epsilon));
+            miss = vor(miss, vor(vlt(u, zero), vgt(u, one)));
+            miss = vor(miss, vor(vlt(v, zero), vgt(vadd(u, v), one)));
 
-                start = intersectionPoint + reflection * 1.0;
-
-                Ray reflectionRay(start, reflection);
+            packet.recordLanes(k, vselect(vandnot(miss, vgt(t, epsilon)), t, none), index);
+        }
+    }
 
-                double reflected_color[3];
-                int nearest = getNearestPoint(reflectionRay, objects);
+    void fillHit(Ray* ray, Hit& hit) {
+        hit.position = ray->start + ray->dir * hit.t;
+        hit.normal = getNormal(hit.position);
+    }
 
-                if(nearest!=-1) {
+    bool getBounds(AABB& box) {
+        box = AABB(a, a);
+        box.expand(b);
+        box.expand(c);
+        return true;
+    }
 
-                    double ret = objects[nearest]->intersect(&reflectionRay, reflected_color, level+1);
-                    if(ret <= 0)
-                        continue;
+    void setColorAt(double* current_color, double* color)
+    {
+        for (int i=0; i<3; i++) {
+            current_color[i] = color[i] * co_efficients[0];
+        }
+    }
 
-                    for (int k=0; k<3; k++) {
-                        current_color[k] += reflected_color[k] * co_efficients[3];
-                    }
-                }
-            }
 
-            updateColorRange(current_color);
-        }
-        return t;
+    void getSurfaceColor(Hit& hit, double surfaceColor[3], double current_color[3]) {
+        for (int k=0; k<3; k++) surfaceColor[k] = color[k];
+        setColorAt(current_color, color);
     }
 };
 
@@ -564,6 +657,11 @@ public:
 
     double A, B, C, D, E, F, G, H, I, J;
 
+    //symmetric 4x4 form, F(p) = [p 1] Q [p 1]^T
+    double Q[4][4];
+    AABB clip;
+    bool clipped[3];
+
     GeneralQuadratic(double coeff[10], point reff, double length, double width, double height) {
         this->A = coeff[0];
         this->B = coeff[1];
@@ -579,6 +677,33 @@ public:
         this->height = height;
         this->width = width;
         this->length = length;
+        compile();
+    }
+
+    void compile() {
+        double q[4][4] = {
+            {A,     D / 2, F / 2, G / 2},
+            {D / 2, B,     E / 2, H / 2},
+            {F / 2, E / 2, C,     I / 2},
+            {G / 2, H / 2, I / 2, J    }
+        };
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                Q[i][j] = q[i][j];
+            }
+        }
+
+        clip = AABB(reference_point, reference_point + point(length, width, height));
+        clipped[0] = length > 0;
+        clipped[1] = width > 0;
+        clipped[2] = height > 0;
+    }
+
+    //inside the clip box along every clipped axis
+    bool insideClip(point p) {
+        return !(clipped[0] && (clip.lo.x > p.x || p.x > clip.hi.x)) &&
+               !(clipped[1] && (clip.lo.y > p.y || p.y > clip.hi.y)) &&
+               !(clipped[2] && (clip.lo.z > p.z || p.z > clip.hi.z));
     }
 
     void draw() {}
@@ -596,50 +721,33 @@ public:
 
     double getIntersectionT(Ray* ray) {
 
-        double a = A * ray->dir.x * ray->dir.x + B * ray->dir.y * ray->dir.y + C * ray->dir.z * ray->dir.z
-                 + D * ray->dir.x * ray->dir.y + E * ray->dir.y * ray->dir.z + F * ray->dir.z * ray->dir.x;
-        double b = 2 * (A * ray->start.x * ray->dir.x + B * ray->start.y * ray->dir.y + C * ray->start.z * ray->dir.z) +
-                 + D * (ray->start.x * ray->dir.y + ray->dir.x * ray->start.y)
-                 + E * (ray->start.y * ray->dir.z + ray->dir.y * ray->start.z)
-                 + F * (ray->start.z * ray->dir.x + ray->dir.z * ray->start.x)
-                 + G * ray->dir.x + H * ray->dir.y + I * ray->dir.z;
-        double c = A * ray->start.x * ray->start.x + B * ray->start.y * ray->start.y + C * ray->start.z * ray->start.z
-                 + D * ray->start.x * ray->start.y + E * ray->start.y * ray->start.z + F * ray->start.z * ray->start.x
-                 + G * ray->start.x + H * ray->start.y + I * ray->start.z + J;
-
-        double d = b*b - 4*a*c;
+        countTest(quadricPrimitive);
 
+        point o = ray->start, d = ray->dir;
 
-        if (d < 0) {
-            return -1;
+        //Q d and the last row of Q applied to [o 1]
+        double qd[3], qo[3];
+        for (int i = 0; i < 3; i++) {
+            qd[i] = Q[i][0] * d.x + Q[i][1] * d.y + Q[i][2] * d.z;
+            qo[i] = Q[i][0] * o.x + Q[i][1] * o.y + Q[i][2] * o.z + Q[i][3];
         }
 
-        double t1 = (- b + sqrt(d)) / (2.0*a);
-        double t2 = (- b - sqrt(d)) / (2.0*a);
+        double a = d.x * qd[0] + d.y * qd[1] + d.z * qd[2];
+        double b = 2 * (o.x * qd[0] + o.y * qd[1] + o.z * qd[2] + Q[3][0] * d.x + Q[3][1] * d.y + Q[3][2] * d.z);
+        double c = o.x * qo[0] + o.y * qo[1] + o.z * qo[2] + Q[3][0] * o.x + Q[3][1] * o.y + Q[3][2] * o.z + Q[3][3];
 
-        point intersectionPoint1 = ray->start + ray->dir * t1;
-        point intersectionPoint2 = ray->start + ray->dir * t2;
+        double disc = b*b - 4*a*c;
 
-        double xMin = reference_point.x;
-        double xMax = reference_point.x + length;
-
-        double yMin = reference_point.y;
-        double yMax = reference_point.y + width;
-
-        double zMin = reference_point.z;
-        double zMax = reference_point.z + height;
-
-        bool f11 = length > 0 && (xMin > intersectionPoint1.x || intersectionPoint1.x > xMax);
-        bool f12 = width > 0 && (yMin > intersectionPoint1.y || intersectionPoint1.y > yMax);
-        bool f13 = height > 0 && (zMin > intersectionPoint1.z || intersectionPoint1.z > zMax);
-
-        bool flag1 = f11 || f12 || f13;
+        if (disc < 0) {
+            return -1;
+        }
 
-        bool f21 = length > 0 && (xMin > intersectionPoint2.x || intersectionPoint2.x > xMax);
-        bool f22 = width > 0 && (yMin > intersectionPoint2.y || intersectionPoint2.y > yMax);
-        bool f23 = height > 0 && (zMin > intersectionPoint2.z || intersectionPoint2.z > zMax);
+        double root = sqrt(disc);
+        double t1 = (- b + root) / (2.0*a);
+        double t2 = (- b - root) / (2.0*a);
 
-        bool flag2 = f21 || f22 || f23;
+        bool flag1 = !insideClip(o + d * t1);
+        bool flag2 = !insideClip(o + d * t2);
 
         if (flag1 && flag2) {
             return -1;
@@ -652,83 +760,109 @@ public:
         }
     }
 
-    void setColorAt(double* current_color, double* color)
-    {
-        for (int i=0; i<3; i++) {
-            current_color[i] = color[i] * co_efficients[0];
-        }
+    //lanes outside the clip box along some clipped axis
+    laneMask outsideClip(lanes x, lanes y, lanes z) {
+        laneMask outX = vand(vmask(clipped[0]), vor(vgt(vset(clip.lo.x), x), vgt(x, vset(clip.hi.x))));
+        laneMask outY = vand(vmask(clipped[1]), vor(vgt(vset(clip.lo.y), y), vgt(y, vset(clip.hi.y))));
+        laneMask outZ = vand(vmask(clipped[2]), vor(vgt(vset(clip.lo.z), z), vgt(z, vset(clip.hi.z))));
+        return vor(vor(outX, outY), outZ);
     }
 
+    void intersectPacket(RayPacket& packet, int index) {
 
-    double intersect(Ray* ray, double current_color[3], int level) {
-
-        double t = getIntersectionT(ray);
-
-        if (t <= 0) return -1;
-        if (level == 0 ) return t;
+        countTest(quadricPrimitive, packetSize);
 
-        setColorAt(current_color, color);
-
-        //cout<<t<<endl;
-        point intersectionPoint = ray->start + ray->dir * t;
+        lanes q[4][4];
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                q[i][j] = vset(Q[i][j]);
+            }
+        }
+        lanes zero = vset(0), two = vset(2), four = vset(4), none = vset(-1);
 
-        point normal = getNormal(intersectionPoint);
+        //same arithmetic as getIntersectionT, a lane at a time
+        for (int k = 0; k < packetSize; k += simdWidth) {
+            lanes ox = vload(packet.ox + k), oy = vload(packet.oy + k), oz = vload(packet.oz + k);
+            lanes dx = vload(packet.dx + k), dy = vload(packet.dy + k), dz = vload(packet.dz + k);
 
-        point reflection = getReflection(ray, normal);
+            lanes qd[3], qo[3];
+            for (int i = 0; i < 3; i++) {
+                qd[i] = vadd(vadd(vmul(q[i][0], dx), vmul(q[i][1], dy)), vmul(q[i][2], dz));
+                qo[i] = vadd(vadd(vadd(vmul(q[i][0], ox), vmul(q[i][1], oy)), vmul(q[i][2], oz)), q[i][3]);
+            }
 
+            lanes a = vadd(vadd(vmul(dx, qd[0]), vmul(dy, qd[1])), vmul(dz, qd[2]));
 
-        for (int i=0; i<lights.size(); i++) {
+            lanes b = vadd(vadd(vmul(ox, qd[0]), vmul(oy, qd[1])), vmul(oz, qd[2]));
+            b = vadd(vadd(vadd(b, vmul(q[3][0], dx)), vmul(q[3][1], dy)), vmul(q[3][2], dz));
+            b = vmul(two, b);
 
-            point dir = lights[i] - intersectionPoint;
-            double len = sqrt(dir.x*dir.x + dir.y*dir.y + dir.z*dir.z);
-            dir.normalize();
+            lanes c = vadd(vadd(vmul(ox, qo[0]), vmul(oy, qo[1])), vmul(oz, qo[2]));
+            c = vadd(vadd(vadd(vadd(c, vmul(q[3][0], ox)), vmul(q[3][1], oy)), vmul(q[3][2], oz)), q[3][3]);
 
-            point start = intersectionPoint + dir*1.0;
-            Ray L(start, dir);
-            //cout<<intersectionPoint<<L.start<<L.dir;
+            lanes disc = vsub(vmul(b, b), vmul(vmul(four, a), c));
 
-            bool hasObstacle = ifHasObstacle(L, objects, len);
+            lanes root = vsqrt(vmax(disc, zero));
+            lanes t1 = vdiv(vadd(vsub(zero, b), root), vmul(two, a));
+            lanes t2 = vdiv(vsub(vsub(zero, b), root), vmul(two, a));
 
-            if (hasObstacle == false){
+            laneMask flag1 = outsideClip(vadd(ox, vmul(dx, t1)), vadd(oy, vmul(dy, t1)), vadd(oz, vmul(dz, t1)));
+            laneMask flag2 = outsideClip(vadd(ox, vmul(dx, t2)), vadd(oy, vmul(dy, t2)), vadd(oz, vmul(dz, t2)));
 
-                double lambert = dotProduct(L.dir, normal);
-                double temp = dotProduct(reflection, ray->dir);
-                double phong = pow(temp, shine);
+            lanes t = vmin(t1, t2);
+            t = vselect(flag2, t1, t);
+            t = vselect(flag1, t2, t);
+            t = vselect(vor(vand(flag1, flag2), vlt(disc, zero)), none, t);
 
-                if(lambert < 0) lambert = 0;
-                if(phong < 0) phong = 0;
+            packet.recordLanes(k, t, index);
+        }
+    }
 
-                for (int k=0; k<3; k++) {
-                    current_color[k] += source_factor * lambert * co_efficients[1] * color[k];
-                    current_color[k] += source_factor * phong * co_efficients[2] * color[k];
-                }
-            }
+    bool getBounds(AABB& box) {
 
-            if (level < recursion_level) {
+        //the clip box bounds every axis with a non zero extent
+        bool bounded[3] = {length > 0, width > 0, height > 0};
+        box = AABB(reference_point, reference_point + point(length, width, height));
 
-                start = intersectionPoint + reflection * 1.0;
+        //an ellipsoid without cross terms bounds itself:
+        //A(x-x0)^2 + B(y-y0)^2 + C(z-z0)^2 = k
+        if (A > 0 && B > 0 && C > 0 && D == 0 && E == 0 && F == 0) {
+            point center(-G / (2 * A), -H / (2 * B), -I / (2 * C));
+            double k = G * G / (4 * A) + H * H / (4 * B) + I * I / (4 * C) - J;
+            if (k < 0) k = 0;
 
-                Ray reflectionRay(start, reflection);
+            point extent(sqrt(k / A), sqrt(k / B), sqrt(k / C));
+            AABB shape(center - extent, center + extent);
 
-                double reflected_color[3];
-                int nearest = getNearestPoint(reflectionRay, objects);
+            if (!bounded[0]) box.lo.x = shape.lo.x, box.hi.x = shape.hi.x;
+            else box.lo.x = max(box.lo.x, shape.lo.x), box.hi.x = min(box.hi.x, shape.hi.x);
+            if (!bounded[1]) box.lo.y = shape.lo.y, box.hi.y = shape.hi.y;
+            else box.lo.y = max(box.lo.y, shape.lo.y), box.hi.y = min(box.hi.y, shape.hi.y);
+            if (!bounded[2]) box.lo.z = shape.lo.z, box.hi.z = shape.hi.z;
+            else box.lo.z = max(box.lo.z, shape.lo.z), box.hi.z = min(box.hi.z, shape.hi.z);
 
-                if(nearest!=-1) {
+            return true;
+        }
 
-                    double ret = objects[nearest]->intersect(&reflectionRay, reflected_color, level+1);
-                    if(ret <= 0)
-                        continue;
+        return bounded[0] && bounded[1] && bounded[2];
+    }
 
-                    for (int k=0; k<3; k++) {
-                        current_color[k] += reflected_color[k] * co_efficients[3];
-                    }
-                }
-            }
+    void fillHit(Ray* ray, Hit& hit) {
+        hit.position = ray->start + ray->dir * hit.t;
+        hit.normal = getNormal(hit.position);
+    }
 
-            updateColorRange(current_color);
+    void setColorAt(double* current_color, double* color)
+    {
+        for (int i=0; i<3; i++) {
+            current_color[i] = color[i] * co_efficients[0];
         }
+    }
 
-        return t;
+
+    void getSurfaceColor(Hit& hit, double surfaceColor[3], double current_color[3]) {
+        for (int k=0; k<3; k++) surfaceColor[k] = color[k];
+        setColorAt(current_color, color);
     }
 };
 
@@ -0,0 +1,236 @@
+//benchmark suite, renders a fixed set of scenes and compares against a baseline
+//build : g++ -O2 -std=c++11 -pthread benchmark.cpp -o benchmark
+//usage : benchmark [-baseline benchmark_baseline.txt] [-save] [-threshold 0.1] [-threads n] [-size n] [-frames n] [-quick] [-wavefront] [-packets]
+//
+//every scene reports Mrays/s, the time per frame and its peak memory. each
+//scene runs in a child process of its own, so the peak is that scene's and not
+//the largest one so far. with a baseline file present the run fails (exit
+//code 1) when a scene gets slower or bigger than the baseline by more than the
+//threshold, -save records the current numbers as the new baseline instead.
+//speed only compares on one machine, so the baseline is not kept in the repo:
+//save it on the machine that runs the check, before the change under test
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<math.h>
+#include<unistd.h>
+#include<sys/resource.h>
+#include<sys/wait.h>
+
+#define HEADLESS
+
+#include "render.hpp"
+#include "test_scenes.hpp"
+
+using namespace std;
+
+struct BenchmarkResult
+{
+    string name;
+    double mrays;       //all rays, camera to shadow, per second of rendering
+    double primaryMrays;
+    double seconds;     //time per frame
+    long memory;        //peak resident size of the scene's process in KB
+};
+
+//renders the loaded scene at least frames times and for at least a second,
+//and keeps the fastest frame, so a short hiccup of the machine does not show
+//up as a regression. only the trace is timed, no frame is saved
+#define minBenchmarkSeconds 1.0
+
+BenchmarkResult runBenchmark(const string& name, int frames)
+{
+    point u(0, 0, 1);
+    point r(1, 0, 0);
+    point l(0, 1, 0);
+    point pos(0, -100, 10);
+
+    BenchmarkResult result;
+    result.name = name;
+    result.seconds = 1e30;
+
+    double spent = 0;
+    for (int f = 0; f < frames || spent < minBenchmarkSeconds; f++) {
+        totalStats = RenderStats();
+        double start = wallTime();
+        renderToFrameBuffer(pos, u, r, l);
+        double seconds = wallTime() - start;
+        spent += seconds;
+
+        if (seconds >= result.seconds) continue;
+
+        long long totalRays = 0;
+        for (int i = 0; i < rayTypes; i++) totalRays += totalStats.rays[i];
+
+        result.seconds = max(seconds, 1e-9);
+        result.mrays = totalRays / result.seconds / 1e6;
+        result.primaryMrays = totalStats.rays[primaryRays] / result.seconds / 1e6;
+    }
+
+    return result;
+}
+
+//loads and renders the scene in a forked child, which sends the numbers back
+//through a pipe. the parent takes the child's peak memory from wait4
+bool runScene(const string& name, int size, int frames, BenchmarkResult& result)
+{
+    int channel[2];
+    if (pipe(channel) != 0) return false;
+
+    pid_t child = fork();
+    if (child < 0) return false;
+
+    if (child == 0) {
+        close(channel[0]);
+        if (!loadTestScene(name)) {
+            cout << "cannot load " << name << endl;
+            _exit(1);
+        }
+        imageWidth = imageHeight = size;
+
+        BenchmarkResult b = runBenchmark(name, frames);
+        char line[256];
+        int length = snprintf(line, sizeof(line), "%.17g %.17g %.17g\n", b.mrays, b.primaryMrays, b.seconds);
+        bool sent = write(channel[1], line, length) == length;
+        cout.flush();
+        _exit(sent ? 0 : 1);
+    }
+
+    close(channel[1]);
+    string line;
+    char buffer[256];
+    ssize_t n;
+    while ((n = read(channel[0], buffer, sizeof(buffer))) > 0) line.append(buffer, n);
+    close(channel[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+
+    result.name = name;
+    result.memory = usage.ru_maxrss;
+    return sscanf(line.c_str(), "%lf %lf %lf", &result.mrays, &result.primaryMrays, &result.seconds) == 3;
+}
+
+map<string, BenchmarkResult> readBaseline(const string& fileName)
+{
+    map<string, BenchmarkResult> baseline;
+
+    ifstream fin(fileName.c_str());
+    BenchmarkResult b;
+    while (fin >> b.name >> b.mrays >> b.primaryMrays >> b.seconds >> b.memory) {
+        baseline[b.name] = b;
+    }
+    return baseline;
+}
+
+void writeBaseline(const string& fileName, vector<BenchmarkResult>& results)
+{
+    ofstream out(fileName.c_str());
+    for (int i = 0; i < results.size(); i++) {
+        BenchmarkResult& b = results[i];
+        out << b.name << " " << b.mrays << " " << b.primaryMrays << " " << b.seconds << " " << b.memory << "\n";
+    }
+}
+
+void usage(const char* name)
+{
+    cout << "usage: " << name << " [-baseline benchmark_baseline.txt] [-save] [-threshold 0.1] [-threads n] [-size n]"
+         << " [-frames n] [-quick] [-wavefront] [-packets]" << endl;
+}
+
+int main(int argc, char **argv){
+
+    string baselineFile = "benchmark_baseline.txt";
+    bool save = false;
+    bool quick = false;
+    double threshold = 0.1;
+    int size = 512;
+    int frames = 5;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+
+        if (arg == "-baseline" && i + 1 < argc) {
+            baselineFile = argv[++i];
+        } else if (arg == "-save") {
+            save = true;
+        } else if (arg == "-threshold" && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (arg == "-size" && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (arg == "-frames" && i + 1 < argc) {
+            frames = max(1, atoi(argv[++i]));
+        } else if (arg == "-quick") {
+            quick = true;
+        } else if (arg == "-wavefront") {
+            wavefront = true;
+        } else if (arg == "-packets") {
+            packets = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    statsFile = "";
+
+    vector<string> names;
+    names.push_back("floor");
+    names.push_back("scene.txt");
+    names.push_back("mirror");
+    names.push_back("stress1k");
+    names.push_back("stress100k");
+    if (!quick) names.push_back("stress1m");
+
+    vector<BenchmarkResult> results;
+
+    for (int i = 0; i < names.size(); i++) {
+        cout << "running " << names[i] << endl;
+        cout.flush();
+
+        BenchmarkResult b;
+        if (!runScene(names[i], size, frames, b)) {
+            cout << names[i] << " failed" << endl;
+            return 1;
+        }
+        results.push_back(b);
+    }
+
+    map<string, BenchmarkResult> baseline = readBaseline(baselineFile);
+    bool failed = false;
+
+    if (!save && baseline.empty()) {
+        cout << "no baseline in " << baselineFile << ", run with -save first to compare against this machine" << endl;
+    }
+
+    printf("\n%-12s %10s %10s %10s %10s   %s\n", "scene", "Mrays/s", "primary", "frame(s)", "peak(MB)", "baseline");
+
+    for (int i = 0; i < results.size(); i++) {
+        BenchmarkResult& b = results[i];
+        printf("%-12s %10.3f %10.3f %10.3f %10.1f", b.name.c_str(), b.mrays, b.primaryMrays, b.seconds, b.memory / 1024.0);
+
+        if (save || baseline.count(b.name) == 0) {
+            printf("   -\n");
+            continue;
+        }
+
+        BenchmarkResult& old = baseline[b.name];
+        bool slower = b.mrays < old.mrays * (1 - threshold);
+        bool bigger = b.memory > old.memory * (1 + threshold);
+
+        printf("   %+.1f%% speed, %+.1f%% memory%s\n", (b.mrays / old.mrays - 1) * 100, (b.memory * 1.0 / old.memory - 1) * 100,
+               slower || bigger ? "  REGRESSION" : "");
+
+        failed |= slower || bigger;
+    }
+
+    if (save) {
+        writeBaseline(baselineFile, results);
+        cout << "baseline saved to " << baselineFile << endl;
+    }
+
+    return failed ? 1 : 0;
+}
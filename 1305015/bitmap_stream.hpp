@@ -0,0 +1,106 @@
+#ifndef BITMAP_STREAM_H
+#define BITMAP_STREAM_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+//one pixel of a bmp row from a color in [0, 1]
+inline void setBGR(unsigned char* p, double r, double g, double b)
+{
+    p[0] = (unsigned char) (b*255);
+    p[1] = (unsigned char) (g*255);
+    p[2] = (unsigned char) (r*255);
+}
+
+//24 bit bmp written piece by piece: the file is sized up front and every
+//block of finished rows is written straight to its place, so the whole
+//image never has to be in memory
+struct BitmapStream
+{
+    ofstream out;
+    int width, height;
+    long long rowBytes;     //3 bytes per pixel, padded to 4
+    long long dataStart;
+    mutex lock;
+
+    template<typename T>
+    void put(T value)
+    {
+        //bmp is little endian, same as the machines we build for
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    bool open(const string& fileName, int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        rowBytes = (3LL * width + 3) / 4 * 4;
+        dataStart = 54;
+
+        out.open(fileName.c_str(), ios::binary);
+        if (!out) {
+            cout << "cannot write " << fileName << endl;
+            return false;
+        }
+
+        long long imageBytes = rowBytes * height;
+
+        //file header
+        put<unsigned short>(19778);
+        put<unsigned int>(dataStart + imageBytes);
+        put<unsigned short>(0);
+        put<unsigned short>(0);
+        put<unsigned int>(dataStart);
+
+        //information header, positive height so rows are stored bottom up
+        put<unsigned int>(40);
+        put<unsigned int>(width);
+        put<unsigned int>(height);
+        put<unsigned short>(1);
+        put<unsigned short>(24);
+        put<unsigned int>(0);
+        put<unsigned int>(imageBytes);
+        put<unsigned int>(0);
+        put<unsigned int>(0);
+        put<unsigned int>(0);
+        put<unsigned int>(0);
+
+        //writing the last byte sizes the file, the padding stays zero
+        if (imageBytes > 0) {
+            out.seekp(dataStart + imageBytes - 1);
+            out.put(0);
+        }
+        return out.good();
+    }
+
+    //rows [y, y + rows) counted from the top, width * 3 bytes each in blue, green, red order
+    void writeRows(int y, int rows, const unsigned char* bgr)
+    {
+        lock_guard<mutex> guard(lock);
+
+        for (int k = 0; k < rows; k++) {
+            out.seekp(dataStart + rowBytes * (height - 1 - (y + k)));
+            out.write(reinterpret_cast<const char*>(bgr + 3LL * width * k), 3LL * width);
+        }
+    }
+
+    //a width x height block with its top left corner at column x of row y,
+    //width * 3 bytes per row in blue, green, red order
+    void writeBlock(int x, int y, int width, int height, const unsigned char* bgr)
+    {
+        lock_guard<mutex> guard(lock);
+
+        for (int k = 0; k < height; k++) {
+            out.seekp(dataStart + rowBytes * (this->height - 1 - (y + k)) + 3LL * x);
+            out.write(reinterpret_cast<const char*>(bgr + 3LL * width * k), 3LL * width);
+        }
+    }
+
+    bool close()
+    {
+        out.close();
+        return !out.fail();
+    }
+};
+
+#endif
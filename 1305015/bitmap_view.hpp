@@ -0,0 +1,91 @@
+#ifndef BITMAP_VIEW_H
+#define BITMAP_VIEW_H
+
+#include "mapped_file.hpp"
+
+//read only view of a 24 bit bmp file: the file is memory mapped, the headers
+//are checked in place and the pixel rows are read straight from the mapping,
+//so opening costs the same for any size and pages are only read when touched.
+//rows count from the top of the image like bitmap_image, bottom up files and
+//row padding are handled by row()
+struct BitmapView
+{
+    MappedFile file;
+    const unsigned char* pixels;    //first row stored in the file
+    int width, height;
+    size_t rowBytes;                //with padding to 4 bytes
+    bool bottomUp;
+
+    BitmapView()
+    {
+        pixels = 0;
+        rowBytes = 0;
+        width = height = 0;
+        bottomUp = true;
+    }
+
+    //false, with a message, if the file cannot be mapped or is not an
+    //uncompressed 24 bit bmp
+    bool open(const string& fileName)
+    {
+        close();
+        if (!file.open(fileName)) return false;
+
+        const unsigned char* header = file.data;
+        size_t fileSize = file.size;
+
+        //14 byte file header and the 40 byte information header
+        bool valid = fileSize >= 54 && header[0] == 'B' && header[1] == 'M' && MappedFile::read32(header + 14) >= 40
+                     && MappedFile::read16(header + 26) == 1 && MappedFile::read16(header + 28) == 24
+                     && MappedFile::read32(header + 30) == 0;
+
+        if (valid) {
+            size_t offset = MappedFile::read32(header + 10);
+            int h = (int) MappedFile::read32(header + 22);
+
+            width = (int) MappedFile::read32(header + 18);
+            height = abs(h);
+            bottomUp = h > 0;
+            rowBytes = (3 * (size_t) width + 3) / 4 * 4;
+
+            valid = width > 0 && height > 0 && offset <= fileSize && rowBytes * height <= fileSize - offset;
+            pixels = header + offset;
+        }
+
+        if (!valid) {
+            cout << fileName << " is not an uncompressed 24 bit bmp" << endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        file.close();
+        pixels = 0;
+        rowBytes = 0;
+        width = height = 0;
+    }
+
+    bool isOpen() const
+    {
+        return file.data != 0;
+    }
+
+    //bgr bytes of row y, 0 is the top row
+    const unsigned char* row(int y) const
+    {
+        return pixels + rowBytes * (bottomUp ? height - 1 - y : y);
+    }
+
+    void get_pixel(int x, int y, unsigned char& r, unsigned char& g, unsigned char& b) const
+    {
+        const unsigned char* p = row(y) + 3 * x;
+        b = p[0];
+        g = p[1];
+        r = p[2];
+    }
+};
+
+#endif
@@ -0,0 +1,283 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "base.hpp"
+#include "record.hpp"
+
+#define bvhLeafSize 4
+
+struct BVHNode
+{
+    AABB box;
+    int left, right;    //children, -1 for a leaf
+    int start, count;   //leaf range in BVH::order
+    int axis;           //split axis, the left child holds the lower centers
+};
+
+//bounding volume hierarchy over the bounded objects, everything without
+//bounds (the floor plane, open quadrics) sits in a list tested for every ray
+struct BVH
+{
+    vector<object*>* scene;
+    vector<BVHNode> nodes;
+    vector<int> order;
+    vector<AABB> boxes;
+    vector<int> unbounded;
+
+    BVH() : scene(0) {}
+
+    void build(vector<object*>& objects)
+    {
+        scene = &objects;
+        nodes.clear();
+        order.clear();
+        unbounded.clear();
+        boxes.assign(objects.size(), AABB());
+
+        for (int k = 0; k < objects.size(); k++) {
+            if (objects[k]->getBounds(boxes[k])) {
+                order.push_back(k);
+            } else {
+                unbounded.push_back(k);
+            }
+        }
+
+        if (!order.empty()) {
+            nodes.reserve(2 * order.size() / bvhLeafSize + 1);
+            buildNode(0, order.size());
+        }
+    }
+
+    int buildNode(int start, int end)
+    {
+        int index = nodes.size();
+        nodes.push_back(BVHNode());
+
+        AABB box, centers;
+        for (int k = start; k < end; k++) {
+            box.expand(boxes[order[k]]);
+            centers.expand(boxes[order[k]].center());
+        }
+
+        nodes[index].box = box;
+        nodes[index].left = nodes[index].right = -1;
+        nodes[index].start = start;
+        nodes[index].count = end - start;
+
+        if (end - start <= bvhLeafSize) {
+            return index;
+        }
+
+        //median split along the widest spread of the centers
+        point extent = centers.hi - centers.lo;
+        int axis = 0;
+        if (extent.y > extent.x) axis = 1;
+        if (extent.z > max(extent.x, extent.y)) axis = 2;
+
+        int middle = (start + end) / 2;
+        nth_element(order.begin() + start, order.begin() + middle, order.begin() + end, [&](int a, int b) {
+            point ca = boxes[a].center(), cb = boxes[b].center();
+            if (axis == 0) return ca.x < cb.x;
+            if (axis == 1) return ca.y < cb.y;
+            return ca.z < cb.z;
+        });
+
+        int left = buildNode(start, middle);
+        int right = buildNode(middle, end);
+
+        nodes[index].left = left;
+        nodes[index].right = right;
+        nodes[index].count = 0;
+        nodes[index].axis = axis;
+
+        return index;
+    }
+
+    //index of the closest object hit with t > 0, -1 if none, minT is updated
+    int nearest(Ray* ray, double& minT)
+    {
+        vector<object*>& objects = *scene;
+        int nearest = -1;
+
+        for (int k = 0; k < unbounded.size(); k++) {
+            double t = objects[unbounded[k]]->getIntersectionT(ray);
+            if (t > 0 && t < minT) {
+                minT = t;
+                nearest = unbounded[k];
+            }
+        }
+
+        if (nodes.empty()) return nearest;
+
+        point invDir(1.0 / ray->dir.x, 1.0 / ray->dir.y, 1.0 / ray->dir.z);
+
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            BVHNode& node = nodes[stack[--top]];
+            countNode();
+
+            double tEnter;
+            if (!node.box.hit(ray, invDir, minT, tEnter)) continue;
+
+            if (node.left == -1) {
+                for (int k = node.start; k < node.start + node.count; k++) {
+                    double t = objects[order[k]]->getIntersectionT(ray);
+                    if (t > 0 && t < minT) {
+                        minT = t;
+                        nearest = order[k];
+                    }
+                }
+                continue;
+            }
+
+            //visit the nearer child first so minT shrinks early
+            double tLeft, tRight;
+            bool hitLeft = nodes[node.left].box.hit(ray, invDir, minT, tLeft);
+            bool hitRight = nodes[node.right].box.hit(ray, invDir, minT, tRight);
+
+            if (hitLeft && hitRight) {
+                if (tLeft < tRight) {
+                    stack[top++] = node.right;
+                    stack[top++] = node.left;
+                } else {
+                    stack[top++] = node.left;
+                    stack[top++] = node.right;
+                }
+            } else if (hitLeft) {
+                stack[top++] = node.left;
+            } else if (hitRight) {
+                stack[top++] = node.right;
+            }
+        }
+        return nearest;
+    }
+
+    //index of some object hit with 0 < t <= len, -1 if none; stops at the first one
+    int anyHit(Ray* ray, double len)
+    {
+        vector<object*>& objects = *scene;
+
+        for (int k = 0; k < unbounded.size(); k++) {
+            if (objects[unbounded[k]]->hitsWithin(ray, len)) return unbounded[k];
+        }
+
+        if (nodes.empty()) return -1;
+
+        point invDir(1.0 / ray->dir.x, 1.0 / ray->dir.y, 1.0 / ray->dir.z);
+
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            BVHNode& node = nodes[stack[--top]];
+            countNode();
+
+            double tEnter;
+            if (!node.box.hit(ray, invDir, len, tEnter)) continue;
+
+            if (node.left == -1) {
+                for (int k = node.start; k < node.start + node.count; k++) {
+                    if (objects[order[k]]->hitsWithin(ray, len)) return order[k];
+                }
+                continue;
+            }
+
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+        return -1;
+    }
+
+    //closest hit for every active lane of the packet, the packet descends
+    //into a node as long as one of its lanes still hits the box
+    void nearestPacket(RayPacket& packet)
+    {
+        vector<object*>& objects = *scene;
+
+        for (int k = 0; k < unbounded.size(); k++) {
+            objects[unbounded[k]]->intersectPacket(packet, unbounded[k]);
+        }
+
+        if (nodes.empty()) return;
+
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            BVHNode& node = nodes[stack[--top]];
+            countNode();
+
+            if (!packet.hitsBox(node.box)) continue;
+
+            if (node.left == -1) {
+                for (int k = node.start; k < node.start + node.count; k++) {
+                    objects[order[k]]->intersectPacket(packet, order[k]);
+                }
+                continue;
+            }
+
+            //front to back along the first lane, its neighbours point the same way
+            double d = node.axis == 0 ? packet.dx[0] : node.axis == 1 ? packet.dy[0] : packet.dz[0];
+            if (d < 0) {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            } else {
+                stack[top++] = node.right;
+                stack[top++] = node.left;
+            }
+        }
+    }
+};
+
+BVH sceneBVH;
+
+//closest hit along the ray, hit is filled in only when something is hit
+bool nearestHit(Ray* ray, Hit& hit)
+{
+    hit.t = 9999999;
+
+    int nearest = sceneBVH.nearest(ray, hit.t);
+    if (nearest == -1) {
+        recordMiss(ray);
+        return false;
+    }
+
+    hit.obj = (*sceneBVH.scene)[nearest];
+    hit.obj->fillHit(ray, hit);
+    recordHit(ray, nearest, hit.t, hit.position);
+    return true;
+}
+
+//object that last blocked each light, per render thread; neighbouring
+//shadow rays are usually blocked by the same object
+thread_local vector<int> lastOccluder;
+
+//shadow ray query: true if something lies between the ray start and len
+bool occluded(Ray* ray, double len, int light)
+{
+    vector<object*>& objects = *sceneBVH.scene;
+
+    if (light >= lastOccluder.size()) {
+        lastOccluder.resize(light + 1, -1);
+    }
+
+    int cached = lastOccluder[light];
+    if (cached >= 0 && cached < objects.size() && objects[cached]->hitsWithin(ray, len)) {
+        recordOccluder(cached);
+        return true;
+    }
+
+    int occluder = sceneBVH.anyHit(ray, len);
+    if (occluder != -1) {
+        lastOccluder[light] = occluder;
+        recordOccluder(occluder);
+    }
+    return occluder != -1;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include "scene.hpp"
+
+//one camera of a fly-through: position plus the up, right and look vectors
+//that keyboardListener turns
+struct CameraKey
+{
+    point pos, u, r, l;
+};
+
+//a camera path file holds one key per line, pos u r l as 12 numbers, lines
+//starting with # are comments
+bool readCameraPath(const string& fileName, vector<CameraKey>& keys)
+{
+    ifstream fin(fileName.c_str());
+    if (!fin.is_open()) {
+        cout << "cannot read " << fileName << endl;
+        return false;
+    }
+
+    string line;
+    while (getline(fin, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        CameraKey k;
+        istringstream in(line);
+        if (in >> k.pos.x >> k.pos.y >> k.pos.z >> k.u.x >> k.u.y >> k.u.z
+               >> k.r.x >> k.r.y >> k.r.z >> k.l.x >> k.l.y >> k.l.z) {
+            keys.push_back(k);
+        }
+    }
+    return !keys.empty();
+}
+
+void appendCameraKey(const string& fileName, point pos, point u, point r, point l)
+{
+    ofstream out(fileName.c_str(), ios::app);
+
+    point vectors[] = {pos, u, r, l};
+    for (int k = 0; k < 4; k++) {
+        out << vectors[k].x << " " << vectors[k].y << " " << vectors[k].z << (k < 3 ? " " : "\n");
+    }
+}
+
+//camera at t in [0, 1] along the keys, positions and directions are blended
+//linearly between neighbouring keys and made orthonormal again
+CameraKey cameraAt(vector<CameraKey>& keys, double t)
+{
+    double x = t * (keys.size() - 1);
+    int k = min((int) x, (int) keys.size() - 2);
+    if (k < 0) return keys[0];
+
+    double f = x - k;
+    CameraKey& a = keys[k];
+    CameraKey& b = keys[k + 1];
+
+    CameraKey c;
+    c.pos = a.pos * (1 - f) + b.pos * f;
+    c.l = a.l * (1 - f) + b.l * f;
+    c.l.normalize();
+
+    //r = l x u and u = r x l, same handedness as the default camera
+    c.r = crossProduct(c.l, a.u * (1 - f) + b.u * f);
+    c.r.normalize();
+    c.u = crossProduct(c.r, c.l);
+    return c;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include "point.hpp"
+
+//camera options shared by the command line programs, each takes three numbers
+#define cameraUsage " [-pos x y z] [-u x y z] [-r x y z] [-l x y z]"
+
+bool readPoint(int argc, char **argv, int& i, point& p)
+{
+    if (i + 3 >= argc) {
+        return false;
+    }
+    p.x = atof(argv[++i]);
+    p.y = atof(argv[++i]);
+    p.z = atof(argv[++i]);
+    return true;
+}
+
+//reads the camera option at argv[i], false if it is not one or its numbers
+//are missing, so the programs call it for any argument they do not know
+bool readCameraOption(int argc, char **argv, int& i, point& pos, point& u, point& r, point& l)
+{
+    string arg = argv[i];
+
+    if (arg == "-pos") return readPoint(argc, argv, i, pos);
+    if (arg == "-u") return readPoint(argc, argv, i, u);
+    if (arg == "-r") return readPoint(argc, argv, i, r);
+    if (arg == "-l") return readPoint(argc, argv, i, l);
+    return false;
+}
+
+#endif
@@ -0,0 +1,358 @@
+//distributed renderer: a coordinator hands the tiles of one frame to worker
+//processes over tcp and puts the returned tiles together into the output bmp
+//build : g++ -O2 -std=c++11 -pthread distributed.cpp -o distributed
+//usage : distributed -coordinator [-port 5005] [-scene scene.txt] [-o output.bmp] [-size w h] [-tile 128] [-timeout 600]
+//                    [-pos x y z] [-u x y z] [-r x y z] [-l x y z]
+//        distributed -worker host [-port 5005] [-threads n] [-wavefront] [-packets]
+//
+//workers may join at any time. a worker that disconnects, or sends nothing for
+//timeout seconds while it holds a tile, is dropped and its tile goes back to
+//the queue for the next free worker
+//
+//messages are one text line each:
+//  coordinator -> worker  SCENE bytes        followed by the scene file
+//                         CAMERA w h pos u r l
+//                         TILE id x y w h    a crop window of the frame
+//                         QUIT
+//  worker -> coordinator  PIXELS id          followed by w * h * 3 bytes, bmp pixels of the tile, top row first
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<math.h>
+#include<poll.h>
+
+#define HEADLESS
+
+#include "render.hpp"
+#include "cli.hpp"
+#include "net.hpp"
+
+using namespace std;
+
+//largest scene a worker accepts, far above the binary stress1m scene
+#define maxSceneBytes (2LL << 30)
+
+struct TileJob
+{
+    int x, y, width, height;
+};
+
+struct Coordinator
+{
+    vector<TileJob> tiles;
+    vector<bool> finished;
+    deque<int> pending;
+    int finishedCount;
+    mutex lock;
+    condition_variable changed;
+
+    BitmapStream output;
+    string scene, camera;
+    int timeout;
+
+    //waits for a tile nobody is working on, false once the frame is done
+    bool next(int& id)
+    {
+        unique_lock<mutex> guard(lock);
+        while (pending.empty() && finishedCount < tiles.size()) {
+            changed.wait(guard);
+        }
+        if (pending.empty()) return false;
+
+        id = pending.front();
+        pending.pop_front();
+        return true;
+    }
+
+    void requeue(int id)
+    {
+        lock_guard<mutex> guard(lock);
+        pending.push_front(id);
+        changed.notify_all();
+    }
+
+    void complete(int id, vector<unsigned char>& bgr)
+    {
+        TileJob& t = tiles[id];
+        output.writeBlock(t.x, t.y, t.width, t.height, &bgr[0]);
+
+        lock_guard<mutex> guard(lock);
+        if (!finished[id]) {
+            finished[id] = true;
+            finishedCount++;
+        }
+        changed.notify_all();
+    }
+
+    bool done()
+    {
+        lock_guard<mutex> guard(lock);
+        return finishedCount == tiles.size();
+    }
+
+    //talks to one worker until the frame is done or the worker is gone
+    void serve(int fd, string name)
+    {
+        bool alive = sendLine(fd, "SCENE " + to_string(scene.size())) && sendAll(fd, scene.data(), scene.size())
+                     && sendLine(fd, camera);
+
+        int id;
+        while (alive && next(id)) {
+            TileJob& t = tiles[id];
+
+            ostringstream job;
+            job << "TILE " << id << " " << t.x << " " << t.y << " " << t.width << " " << t.height;
+
+            string reply;
+            vector<unsigned char> bgr(3LL * t.width * t.height);
+
+            alive = sendLine(fd, job.str()) && receiveLine(fd, reply) && reply == "PIXELS " + to_string(id)
+                    && receiveAll(fd, &bgr[0], bgr.size());
+
+            if (alive) {
+                complete(id, bgr);
+            } else {
+                cout << "lost worker " << name << ", tile " << id << " goes back to the queue" << endl;
+                requeue(id);
+            }
+        }
+
+        if (alive) {
+            sendLine(fd, "QUIT");
+        }
+        close(fd);
+    }
+};
+
+string cameraLine(point pos, point u, point r, point l)
+{
+    ostringstream line;
+    line << setprecision(17) << "CAMERA " << imageWidth << " " << imageHeight;
+
+    point vectors[] = {pos, u, r, l};
+    for (int k = 0; k < 4; k++) {
+        line << " " << vectors[k].x << " " << vectors[k].y << " " << vectors[k].z;
+    }
+    return line.str();
+}
+
+int runCoordinator(int port, const string& sceneFile, const string& outputFile, int width, int height, int tileWidth,
+                   int timeout, point pos, point u, point r, point l)
+{
+    ifstream fin(sceneFile.c_str(), ios::binary);
+    if (!fin.is_open()) {
+        cout << "cannot read " << sceneFile << endl;
+        return 1;
+    }
+
+    Coordinator c;
+    c.scene.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+    c.timeout = timeout;
+
+    //only the image size is needed here, the workers load the scene
+    if (isBinaryScene((const unsigned char*) c.scene.data(), c.scene.size())) {
+        const SceneFileHeader* header = (const SceneFileHeader*) c.scene.data();
+        recursion_level = header->recursionLevel;
+        imageWidth = header->imageWidth;
+        imageHeight = header->imageHeight;
+    } else {
+        istringstream header(c.scene);
+        readSceneHeader(header);
+    }
+    if (width > 0 && height > 0) {
+        imageWidth = width;
+        imageHeight = height;
+    }
+    c.camera = cameraLine(pos, u, r, l);
+
+    for (int y = 0; y < imageHeight; y += tileWidth) {
+        for (int x = 0; x < imageWidth; x += tileWidth) {
+            TileJob t = {x, y, min(tileWidth, imageWidth - x), min(tileWidth, imageHeight - y)};
+            c.pending.push_back(c.tiles.size());
+            c.tiles.push_back(t);
+        }
+    }
+    c.finished.assign(c.tiles.size(), false);
+    c.finishedCount = 0;
+
+    if (!c.output.open(outputFile, imageWidth, imageHeight)) return 1;
+
+    int server = listenOn(port);
+    if (server < 0) {
+        cout << "cannot listen on port " << port << endl;
+        return 1;
+    }
+    cout << "waiting for workers on port " << port << ", " << c.tiles.size() << " tiles" << endl;
+
+    double start = wallTime();
+    vector<thread> workers;
+
+    while (!c.done()) {
+        pollfd waiting = {server, POLLIN, 0};
+        if (poll(&waiting, 1, 200) <= 0) continue;
+
+        sockaddr_in address;
+        socklen_t length = sizeof(address);
+        int fd = accept(server, (sockaddr*) &address, &length);
+        if (fd < 0) continue;
+
+        setReceiveTimeout(fd, c.timeout);
+
+        string name = to_string(workers.size()) + " (port " + to_string(ntohs(address.sin_port)) + ")";
+        cout << "worker " << name << " joined" << endl;
+
+        workers.push_back(thread(&Coordinator::serve, &c, fd, name));
+    }
+    close(server);
+
+    for (int w = 0; w < workers.size(); w++) {
+        workers[w].join();
+    }
+
+    if (!c.output.close()) {
+        cout << "cannot write " << outputFile << endl;
+        return 1;
+    }
+    cout << "frame done in " << wallTime() - start << " s" << endl;
+    return 0;
+}
+
+int runWorker(const string& host, int port)
+{
+    int fd = connectTo(host, port);
+    if (fd < 0) {
+        cout << "cannot connect to " << host << ":" << port << endl;
+        return 1;
+    }
+
+    point pos, u, r, l;
+    int width = 0, height = 0;
+    string line;
+
+    while (receiveLine(fd, line)) {
+        istringstream message(line);
+        string command;
+        message >> command;
+
+        if (command == "SCENE") {
+            long long size = -1;
+
+            //the rest of the stream cannot be trusted after a bad size
+            if (!(message >> size) || size < 0 || size > maxSceneBytes) {
+                cout << "bad scene size " << size << " from the coordinator" << endl;
+                break;
+            }
+
+            string scene(size, ' ');
+            if (size > 0 && !receiveAll(fd, &scene[0], size)) break;
+
+            freeMemory();
+            if (isBinaryScene((const unsigned char*) scene.data(), scene.size())) {
+                loadBinaryScene((const unsigned char*) scene.data(), scene.size(), "scene");
+            } else {
+                istringstream fin(scene);
+                loadScene(fin);
+            }
+        } else if (command == "CAMERA") {
+            message >> width >> height;
+            message >> pos.x >> pos.y >> pos.z >> u.x >> u.y >> u.z;
+            message >> r.x >> r.y >> r.z >> l.x >> l.y >> l.z;
+        } else if (command == "TILE") {
+            int id;
+            message >> id >> cropWindow.x >> cropWindow.y >> cropWindow.width >> cropWindow.height;
+
+            imageWidth = width;
+            imageHeight = height;
+            renderToFrameBuffer(pos, u, r, l);
+
+            vector<unsigned char> bgr(3LL * frameBuffer.width * frameBuffer.height);
+            for (int i = 0; i < frameBuffer.height; i++) {
+                for (int j = 0; j < frameBuffer.width; j++) {
+                    float* c = frameBuffer.pixel(i, j);
+                    setBGR(&bgr[3LL * (i * frameBuffer.width + j)], c[0], c[1], c[2]);
+                }
+            }
+
+            if (!sendLine(fd, "PIXELS " + to_string(id)) || !sendAll(fd, &bgr[0], bgr.size())) break;
+        } else if (command == "QUIT") {
+            break;
+        }
+    }
+
+    close(fd);
+    freeMemory();
+    return 0;
+}
+
+void usage(const char* name)
+{
+    cout << "usage: " << name << " -coordinator [-port 5005] [-scene scene.txt] [-o output.bmp] [-size w h] [-tile 128] [-timeout 600]"
+         << cameraUsage << endl;
+    cout << "       " << name << " -worker host [-port 5005] [-threads n] [-wavefront] [-packets]" << endl;
+}
+
+int main(int argc, char **argv){
+
+    bool coordinator = false;
+    string host;
+    int port = 5005;
+
+    string sceneFile = "scene.txt";
+    string outputFile = "output.bmp";
+    int width = 0, height = 0;
+    int tileWidth = 128;
+    int timeout = 600;
+
+    //same camera as init() of main.cpp
+    point u(0, 0, 1);
+    point r(1, 0, 0);
+    point l(0, 1, 0);
+    point pos(0, -100, 10);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool ok = true;
+
+        if (arg == "-coordinator") {
+            coordinator = true;
+        } else if (arg == "-worker" && i + 1 < argc) {
+            host = argv[++i];
+        } else if (arg == "-port" && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (arg == "-scene" && i + 1 < argc) {
+            sceneFile = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (arg == "-size" && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        } else if (arg == "-tile" && i + 1 < argc) {
+            tileWidth = max(1, atoi(argv[++i]));
+        } else if (arg == "-timeout" && i + 1 < argc) {
+            timeout = atoi(argv[++i]);
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (arg == "-wavefront") {
+            wavefront = true;
+        } else if (arg == "-packets") {
+            packets = true;
+        } else {
+            ok = readCameraOption(argc, argv, i, pos, u, r, l);
+        }
+
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (coordinator == !host.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (coordinator) {
+        return runCoordinator(port, sceneFile, outputFile, width, height, tileWidth, timeout, pos, u, r, l);
+    }
+    return runWorker(host, port);
+}
@@ -0,0 +1,60 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "point.hpp"
+#include <vector>
+
+//one contiguous block of float rgb, row after row, kept between captures and
+//only reallocated when the resolution changes
+struct FrameBuffer
+{
+    vector<float> storage;
+    float* data;            //storage rounded up to a 64 byte boundary
+    int width, height;
+
+    FrameBuffer()
+    {
+        data = 0;
+        width = height = 0;
+    }
+
+    void resize(int width, int height)
+    {
+        if (width != this->width || height != this->height) {
+            this->width = width;
+            this->height = height;
+
+            vector<float>(3LL * width * height + 16).swap(storage);
+
+            size_t address = reinterpret_cast<size_t>(&storage[0]);
+            data = &storage[0] + ((64 - address % 64) % 64) / sizeof(float);
+        }
+        clear();
+    }
+
+    void clear()
+    {
+        fill(data, data + 3LL * width * height, 0.0f);
+    }
+
+    float* pixel(int row, int column)
+    {
+        return data + 3LL * ((long long) row * width + column);
+    }
+
+    void set(int row, int column, point color)
+    {
+        float* p = pixel(row, column);
+        p[0] = color.x;
+        p[1] = color.y;
+        p[2] = color.z;
+    }
+
+    point get(int row, int column)
+    {
+        float* p = pixel(row, column);
+        return point(p[0], p[1], p[2]);
+    }
+};
+
+#endif
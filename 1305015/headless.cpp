@@ -0,0 +1,105 @@
+//command line renderer, no window and no glut
+//build : g++ -O2 -std=c++11 -pthread headless.cpp -o headless
+//        -packets runs on SSE2 by default, add -mavx2 (or -march=native) for the 4 wide AVX kernels
+//usage : headless [-scene scene.txt] [-o output.bmp] [-threads n] [-stats stats.json] [-wavefront] [-packets] [-aa samples] [-aathreshold t] [-stream] [-progressive] [-size w h] [-crop x y w h] [-pos x y z] [-u x y z] [-r x y z] [-l x y z]
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<math.h>
+
+#define HEADLESS
+
+#include "render.hpp"
+#include "cli.hpp"
+
+using namespace std;
+
+void usage(const char* name)
+{
+    cout << "usage: " << name << " [-scene scene.txt] [-o output.bmp] [-threads n] [-stats stats.json] [-wavefront] [-packets] [-aa samples] [-aathreshold t] [-stream] [-progressive]"
+         << " [-size w h] [-crop x y w h]" cameraUsage << endl;
+}
+
+int main(int argc, char **argv){
+
+    string sceneFile = "scene.txt";
+    string outputFile = "output.bmp";
+
+    //same camera as init() of main.cpp
+    point u(0, 0, 1);
+    point r(1, 0, 0);
+    point l(0, 1, 0);
+    point pos(0, -100, 10);
+
+    //save every preview level to the output file as soon as it is done
+    bool progressive = false;
+
+    //size from the command line, overrides the scene file
+    int width = 0, height = 0;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool ok = true;
+
+        if (arg == "-scene" && i + 1 < argc) {
+            sceneFile = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (arg == "-stats" && i + 1 < argc) {
+            statsFile = argv[++i];
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (arg == "-wavefront") {
+            wavefront = true;
+        } else if (arg == "-packets") {
+            packets = true;
+        } else if (arg == "-aa" && i + 1 < argc) {
+            aaSamples = max(1, atoi(argv[++i]));
+        } else if (arg == "-aathreshold" && i + 1 < argc) {
+            aaThreshold = atof(argv[++i]);
+        } else if (arg == "-stream") {
+            streamOutput = true;
+        } else if (arg == "-progressive") {
+            progressive = true;
+        } else if (arg == "-size" && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        } else if (arg == "-crop" && i + 4 < argc) {
+            cropWindow.x = atoi(argv[++i]);
+            cropWindow.y = atoi(argv[++i]);
+            cropWindow.width = atoi(argv[++i]);
+            cropWindow.height = atoi(argv[++i]);
+        } else {
+            ok = readCameraOption(argc, argv, i, pos, u, r, l);
+        }
+
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!loadActualData(sceneFile)) {
+        return 1;
+    }
+
+    if (width > 0 && height > 0) {
+        imageWidth = width;
+        imageHeight = height;
+    }
+
+    if (progressive) {
+        double start = wallTime();
+        function<void(int)> preview = [&](int step) {
+            cout << " level " << step << " done after " << wallTime() - start << " s" << endl;
+            if (step > 1) saveFrameBuffer(frameBuffer, outputFile);
+        };
+        renderScene(pos, u, r, l, outputFile, &preview);
+    } else {
+        renderScene(pos, u, r, l, outputFile);
+    }
+
+    freeMemory();
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+//incremental renderer for look-dev: after an edit of the scene file only the
+//tiles the edit can change are traced again
+//build : g++ -O2 -std=c++11 -pthread incremental.cpp -o incremental
+//usage : incremental [-scene scene.txt] [-o output.bmp] [-edit edited.txt] [-watch] [-threads n] [-size w h]
+//                    [-pos x y z] [-u x y z] [-r x y z] [-l x y z]
+//
+//the first render records for every tile the objects its rays hit or that
+//blocked its shadow rays, and bounds of all of its rays (see TileRecord).
+//objects are matched by their position in the file and compared by their text.
+//a tile is traced again when it touched a changed object as it was before, or
+//when one of its rays passes the bounds of a changed object as it is now.
+//other edits (lights, recursion level, size) trace the whole frame.
+//-edit applies one edited file, -watch re-renders whenever the scene file is saved
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<math.h>
+#include<sys/stat.h>
+
+#define HEADLESS
+
+#include "render.hpp"
+#include "cli.hpp"
+
+using namespace std;
+
+//what an edit is compared against
+struct SceneState
+{
+    vector<string> sources;
+    bool hasSources;    //every object has its source text, binary scenes have none
+    vector<point> lights;
+    int recursion_level, imageWidth, imageHeight;
+
+    void take()
+    {
+        sources = objectSources;
+        hasSources = objectSources.size() == objects.size();
+        lights = ::lights;
+        recursion_level = ::recursion_level;
+        imageWidth = ::imageWidth;
+        imageHeight = ::imageHeight;
+    }
+
+    bool sameSetup()
+    {
+        if (!hasSources || objectSources.size() != objects.size()) return false;
+        if (lights.size() != ::lights.size()) return false;
+        for (int i = 0; i < lights.size(); i++) {
+            point d = lights[i] - ::lights[i];
+            if (d.x != 0 || d.y != 0 || d.z != 0) return false;
+        }
+        return recursion_level == ::recursion_level && imageWidth == ::imageWidth && imageHeight == ::imageHeight;
+    }
+};
+
+//tiles whose record can see a change between before and the loaded scene
+vector<int> changedTiles(SceneState& before)
+{
+    vector<int> tiles;
+
+    int count = max(before.sources.size(), objectSources.size());
+    vector<bool> changed(count, false);
+    vector<AABB> bounds;
+    bool unbounded = false;
+
+    for (int i = 0; i < count; i++) {
+        changed[i] = i >= before.sources.size() || i >= objectSources.size() || before.sources[i] != objectSources[i];
+
+        if (changed[i] && i < objects.size()) {
+            AABB box;
+            if (objects[i]->getBounds(box)) {
+                bounds.push_back(box);
+            } else {
+                unbounded = true;
+            }
+        }
+    }
+
+    for (int t = 0; t < tileRecords.size(); t++) {
+        TileRecord& record = tileRecords[t];
+        bool dirty = unbounded;
+
+        //the objects of the record are indices of the scene before the edit
+        for (int k = 0; k < record.objects.size() && !dirty; k++) {
+            dirty = changed[record.objects[k]];
+        }
+
+        for (int b = 0; b < bounds.size() && !dirty; b++) {
+            dirty = record.mayHit(bounds[b], lights);
+        }
+
+        if (dirty) tiles.push_back(t);
+    }
+    return tiles;
+}
+
+//loads the scene again and traces what changed since before, the whole frame
+//if the records cannot tell. width and height are the -size of the command
+//line, 0 when the size comes from the scene file
+void update(const string& sceneFile, const string& outputFile, point pos, point u, point r, point l, int width, int height)
+{
+    SceneState before;
+    before.take();
+
+    freeMemory();
+    if (!loadActualData(sceneFile)) return;
+
+    //a size from the command line stays, otherwise the edited file's size counts
+    if (width > 0 && height > 0) {
+        imageWidth = width;
+        imageHeight = height;
+    }
+
+    double start = wallTime();
+
+    if (!before.sameSetup()) {
+        renderToFrameBuffer(pos, u, r, l);
+        cout << " traced the whole frame in " << wallTime() - start << " s" << endl;
+    } else {
+        vector<int> tiles = changedTiles(before);
+        if (!tiles.empty()) {
+            renderToFrameBuffer(pos, u, r, l, &tiles);
+        }
+        cout << " traced " << tiles.size() << " of " << tileRecords.size() << " tiles in " << wallTime() - start << " s" << endl;
+    }
+
+    saveFrameBuffer(frameBuffer, outputFile);
+}
+
+long long modifiedTime(const string& fileName)
+{
+    struct stat info;
+    if (stat(fileName.c_str(), &info) != 0) return -1;
+    return info.st_mtime;
+}
+
+void usage(const char* name)
+{
+    cout << "usage: " << name << " [-scene scene.txt] [-o output.bmp] [-edit edited.txt] [-watch] [-threads n] [-size w h]"
+         << cameraUsage << endl;
+}
+
+int main(int argc, char **argv){
+
+    string sceneFile = "scene.txt";
+    string outputFile = "output.bmp";
+    string editFile;
+    bool watch = false;
+    int width = 0, height = 0;
+
+    //same camera as init() of main.cpp
+    point u(0, 0, 1);
+    point r(1, 0, 0);
+    point l(0, 1, 0);
+    point pos(0, -100, 10);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool ok = true;
+
+        if (arg == "-scene" && i + 1 < argc) {
+            sceneFile = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (arg == "-edit" && i + 1 < argc) {
+            editFile = argv[++i];
+        } else if (arg == "-watch") {
+            watch = true;
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (arg == "-size" && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        } else {
+            ok = readCameraOption(argc, argv, i, pos, u, r, l);
+        }
+
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!loadActualData(sceneFile)) {
+        return 1;
+    }
+    if (width > 0 && height > 0) {
+        imageWidth = width;
+        imageHeight = height;
+    }
+
+    recordTiles = true;
+
+    double start = wallTime();
+    renderToFrameBuffer(pos, u, r, l);
+    cout << " traced the whole frame in " << wallTime() - start << " s" << endl;
+    saveFrameBuffer(frameBuffer, outputFile);
+
+    if (!editFile.empty()) {
+        update(editFile, outputFile, pos, u, r, l, width, height);
+    }
+
+    long long seen = modifiedTime(sceneFile);
+    while (watch) {
+        this_thread::sleep_for(chrono::milliseconds(500));
+
+        long long now = modifiedTime(sceneFile);
+        if (now != seen) {
+            seen = now;
+            update(sceneFile, outputFile, pos, u, r, l, width, height);
+        }
+    }
+
+    freeMemory();
+    return 0;
+}
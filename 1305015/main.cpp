@@ -5,17 +5,11 @@
 #include <windows.h>
 #include <glut.h>
 
-#include "base.hpp"
-#include "bitmap_image.hpp"
+#include "render.hpp"
+#include "camera_path.hpp"
 
 using namespace std;
 
-#define pi (2*acos(0.0))
-
-#define windowWidth 500
-#define windowHeight 500
-#define fov 80
-
 double cameraHeight;
 double cameraAngle;
 int drawgrid;
@@ -29,27 +23,11 @@ float amountToBeIncreased = 0.4;
 
 void capture();
 
-int imageWidth, imageHeight;
-int recursion_level;
+//key 8 turns on the coarse to fine previews of capture
+bool showPreviews = false;
 
 point pos, u, r, l;
 
-vector<object*> objects;
-vector<point> lights; //actually not point, vector
-
-point crossProduct(point a, point b)
-{
-    point ret;
-    ret.x = a.y * b.z - a.z * b.y;
-    ret.y = a.z * b.x - a.x * b.z;
-    ret.z = a.x * b.y - a.y * b.x;
-    return ret;
-}
-
-double dotProduct(point a, point b) {
-    return a.x*b.x + a.y*b.y + a.z*b.z;
-}
-
 void update(point *toupdate, point *by, double angle)
 {
     toupdate->x = toupdate->x * cos(angle) + by->x * sin(angle);
@@ -63,6 +41,13 @@ void keyboardListener(unsigned char key, int x,int y){
 	switch(key){
         case '0':
             capture();
+            break;
+        case '7':
+            //key of a fly-through for the animate renderer
+            appendCameraKey("camera_path.txt", pos, u, r, l);
+            break;
+        case '8':
+            showPreviews = !showPreviews;
             break;
 		case '1':
 			t1 = crossProduct(u, l);
@@ -374,194 +359,53 @@ void loadTestData()
     temp->setCoEfficients(0.4, 0.2, 0.1, 0.3);
     temp->setShine(5);
     objects.push_back(temp);
-}
-
-void loadActualData() {
-
-    //freopen("scene.txt", "r", stdin);
-    ifstream fin("scene.txt");
-    if(fin.is_open() == false)
-    {
-        cout << "very serious error";
-        return;
-    }
-
-    fin>>recursion_level;
-    fin>>imageWidth;
-    imageHeight = imageWidth;
-
-    int numOfObjects;
-    fin>>numOfObjects;
-
-    string command;
-    double a, b, c, radius;
-
-    object *temp;
-
-    for (int i=0; i<numOfObjects; i++) {
-        fin>>command;
-
-        if (command == "sphere") {
-
-            fin>>a>>b>>c;
-            point center(a, b, c);
-
-            fin>>radius;
-            temp = new sphere(center, radius);
-
-            fin>>a>>b>>c;
-            temp->setColor(a, b, c);
-
-            fin>>a>>b>>c>>radius;
-            temp->setCoEfficients(a, b, c, radius);
-
-            fin>>a;
-            temp->setShine(a);
-
-            objects.push_back(temp);
-        }
-
-        else if (command == "triangle") {
-
-            fin>>a>>b>>c;
-            point A(a, b, c);
-
-            fin>>a>>b>>c;
-            point B(a, b, c);
-
-            fin>>a>>b>>c;
-            point C(a, b, c);
-
-            temp = new Triangle(A, B, C);
-
-            fin>>a>>b>>c;
-            temp->setColor(a, b, c);
-
-            fin>>a>>b>>c>>radius;
-            temp->setCoEfficients(a, b, c, radius);
-
-            fin>>a;
-            temp->setShine(a);
-
-            objects.push_back(temp);
-
-        }
-
-        else if (command == "general") {
-
-            double coeff[10];
-            for (int c=0; c<10; c++) {
-                fin>>coeff[c];
-            }
-
-            fin>>a>>b>>c;
-            point reff(a, b, c);
-
-            fin>>a>>b>>c;
-            temp = new GeneralQuadratic(coeff, reff, a, b, c);
-
-            fin>>a>>b>>c;
-            temp->setColor(a, b, c);
-
-            fin>>a>>b>>c>>radius;
-            temp->setCoEfficients(a, b, c, radius);
-
-            fin>>a;
-            temp->setShine(a);
-
-            objects.push_back(temp);
-
-        }
-
-    }
-
-    fin>>numOfObjects;
-    for (int i=0; i<numOfObjects; i++) {
-        fin>>a>>b>>c;
 
-        point light(a, b, c);
-        lights.push_back(light);
-    }
-
-
-    temp = new Floor(1000, 20);
-    temp->setCoEfficients(0.4,0.2,0.2,0.2);
-    temp->setShine(1);
-    objects.push_back(temp);
+    compileScene();
+}
 
-    fin.close();
+//draws frameBuffer over the whole window, top row at the top
+void drawFrameBuffer()
+{
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glDisable(GL_DEPTH_TEST);
+    glRasterPos2f(-1, 1);
+    glPixelZoom(windowWidth * 1.0 / frameBuffer.width, -windowHeight * 1.0 / frameBuffer.height);
+    glDrawPixels(frameBuffer.width, frameBuffer.height, GL_RGB, GL_FLOAT, frameBuffer.data);
+    glPixelZoom(1, 1);
+    glEnable(GL_DEPTH_TEST);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    glutSwapBuffers();
 }
 
 void capture()
 {
-    point** frameBuffer;
-    frameBuffer = new point* [imageWidth];
-
-    for (int i = 0; i < imageWidth; i++) {
-        frameBuffer[i] = new point [imageHeight];
-        for (int j = 0; j < imageHeight; j++) {
-            frameBuffer[i][j] = {0, 0, 0};
-        }
-    }
-
-    double planeDistance = (windowHeight/2.0)/tan(fov*pi/360.0);
-
-    point topLeft = pos + l * planeDistance - r * windowWidth / 2.0 + u * windowHeight / 2.0;
+    //corner of the view plane, printed on every capture as before
+    point topLeft;
+    double du, dv;
+    viewPlane(pos, u, r, l, topLeft, du, dv);
     cout << topLeft;
 
-    double du = (windowWidth * 1.0) / imageWidth;
-    double dv = (windowHeight * 1.0) / imageHeight;
-
-    for (int i = 0; i < imageWidth; i++) {
-        for (int j = 0; j < imageHeight; j++) {
-
-            point cornerDir = topLeft + r*j*du - u*i*dv;
-            //cout<<cornerDir;
-
-            Ray r(pos, cornerDir - pos);
-
-            int nearest=-1;
-            double minT = 9999999;
-            double color[3];
-
-            for (int k = 0; k < objects.size(); k++) {
-
-                double t = objects[k]->intersect(&r, color, 0);
-
-                if(t <= 0)
-                    continue;
-                else if (t < minT) {
-                    minT = t;
-                    nearest = k;
-                }
-
-            }
-
-            if(nearest!=-1) {
-
-                double t = objects[nearest]->intersect(&r, color, 1);
-
-                frameBuffer[i][j] = point(color);
-
-            }
-        }
-    }
-
-
-    bitmap_image image(imageWidth, imageHeight);
-
-    for (int i=0; i<imageWidth; i++) {
-        for (int j=0; j<imageHeight; j++) {
-            image.set_pixel(j, i, frameBuffer[i][j].x*255, frameBuffer[i][j].y*255, frameBuffer[i][j].z*255);
-        }
+    if (!showPreviews) {
+        renderScene(pos, u, r, l, "output.bmp");
+        return;
     }
 
-    image.save_image("output.bmp");
-}
-
-void freeMemory() {
-    vector<point>().swap(lights);
-    vector<object*>().swap(objects);
+    //the window shows every level of the progressive render, coarse to fine
+    function<void(int)> preview = [](int step) {
+        drawFrameBuffer();
+    };
+    renderScene(pos, u, r, l, "output.bmp", &preview);
 }
 
 int main(int argc, char **argv){
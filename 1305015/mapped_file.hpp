@@ -0,0 +1,95 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <bits/stdc++.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+using namespace std;
+
+//a whole file mapped read only into memory, its pages are read when they are
+//first touched. windows has no mmap, there the file is read into memory once
+//instead
+struct MappedFile
+{
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    vector<unsigned char> contents;
+#endif
+
+    MappedFile()
+    {
+        data = 0;
+        size = 0;
+    }
+
+    //the mapping is not shared between copies
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    //false, with a message, if the file cannot be read or is empty
+    bool open(const string& fileName)
+    {
+        close();
+
+#ifndef _WIN32
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                void* mapping = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping != MAP_FAILED) {
+                    data = (const unsigned char*) mapping;
+                    size = info.st_size;
+                }
+            }
+            ::close(fd);
+        }
+#else
+        ifstream in(fileName.c_str(), ios::binary);
+        contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        if (!contents.empty()) {
+            data = &contents[0];
+            size = contents.size();
+        }
+#endif
+
+        if (data == 0) {
+            cout << "cannot read " << fileName << endl;
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifndef _WIN32
+        if (data) munmap((void*) data, size);
+#else
+        vector<unsigned char>().swap(contents);
+#endif
+        data = 0;
+        size = 0;
+    }
+
+    static unsigned int read16(const unsigned char* p)
+    {
+        return p[0] | (p[1] << 8);
+    }
+
+    static unsigned int read32(const unsigned char* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+    }
+};
+
+#endif
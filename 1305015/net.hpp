@@ -0,0 +1,107 @@
+#ifndef NET_H
+#define NET_H
+
+#include <bits/stdc++.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <unistd.h>
+using namespace std;
+
+//blocking tcp helpers for the distributed renderer, every call returns
+//false or -1 once the other side is gone
+
+int listenOn(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(fd, (sockaddr*) &address, sizeof(address)) < 0 || listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connectTo(const string& host, int port)
+{
+    addrinfo hints, *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &result) != 0) return -1;
+
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+//a receive that waits longer than seconds fails, 0 waits forever
+void setReceiveTimeout(int fd, int seconds)
+{
+    timeval timeout;
+    timeout.tv_sec = seconds;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+bool sendAll(int fd, const void* data, long long size)
+{
+    const char* p = (const char*) data;
+    while (size > 0) {
+        //MSG_NOSIGNAL, a dead peer must not kill the process with SIGPIPE
+        long long sent = send(fd, p, size, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        p += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool receiveAll(int fd, void* data, long long size)
+{
+    char* p = (char*) data;
+    while (size > 0) {
+        long long got = recv(fd, p, size, 0);
+        if (got <= 0) return false;
+        p += got;
+        size -= got;
+    }
+    return true;
+}
+
+bool sendLine(int fd, const string& line)
+{
+    string message = line + "\n";
+    return sendAll(fd, message.data(), message.size());
+}
+
+//messages are short, so reading them a byte at a time is fine
+bool receiveLine(int fd, string& line)
+{
+    line.clear();
+
+    char c;
+    while (receiveAll(fd, &c, 1)) {
+        if (c == '\n') return true;
+        line += c;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef PACKET_H
+#define PACKET_H
+
+#include "point.hpp"
+#include <cmath>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+//lanes per packet: 8 camera rays, a 2x4 block of pixels
+#define packetSize 8
+#define packetRows 2
+#define packetColumns 4
+
+//doubles per SIMD register: 4 with AVX (-mavx2 or -march=native), 2 with the
+//SSE2 every x86-64 build has, 1 elsewhere. the kernels work in doubles with the
+//same operations in the same order as the scalar tests, so a packet finds the
+//same hits as single rays do
+#if defined(__AVX__)
+
+#define simdWidth 4
+typedef __m256d lanes;
+typedef __m256d laneMask;
+
+inline lanes vload(const double* p) { return _mm256_load_pd(p); }
+inline void vstore(double* p, lanes a) { _mm256_store_pd(p, a); }
+inline lanes vset(double a) { return _mm256_set1_pd(a); }
+inline lanes vadd(lanes a, lanes b) { return _mm256_add_pd(a, b); }
+inline lanes vsub(lanes a, lanes b) { return _mm256_sub_pd(a, b); }
+inline lanes vmul(lanes a, lanes b) { return _mm256_mul_pd(a, b); }
+inline lanes vdiv(lanes a, lanes b) { return _mm256_div_pd(a, b); }
+inline lanes vsqrt(lanes a) { return _mm256_sqrt_pd(a); }
+//operands swapped so both pick like std::min and std::max, also for NaN
+inline lanes vmin(lanes a, lanes b) { return _mm256_min_pd(b, a); }
+inline lanes vmax(lanes a, lanes b) { return _mm256_max_pd(b, a); }
+inline laneMask vlt(lanes a, lanes b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+inline laneMask vle(lanes a, lanes b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+inline laneMask vgt(lanes a, lanes b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+inline laneMask vand(laneMask a, laneMask b) { return _mm256_and_pd(a, b); }
+inline laneMask vor(laneMask a, laneMask b) { return _mm256_or_pd(a, b); }
+inline laneMask vandnot(laneMask a, laneMask b) { return _mm256_andnot_pd(a, b); }
+inline laneMask vmask(bool a) { return _mm256_castsi256_pd(_mm256_set1_epi64x(a ? -1 : 0)); }
+//a where mask is set, b elsewhere
+inline lanes vselect(laneMask mask, lanes a, lanes b) { return _mm256_blendv_pd(b, a, mask); }
+inline int vbits(laneMask mask) { return _mm256_movemask_pd(mask); }
+
+#elif defined(__SSE2__)
+
+#define simdWidth 2
+typedef __m128d lanes;
+typedef __m128d laneMask;
+
+inline lanes vload(const double* p) { return _mm_load_pd(p); }
+inline void vstore(double* p, lanes a) { _mm_store_pd(p, a); }
+inline lanes vset(double a) { return _mm_set1_pd(a); }
+inline lanes vadd(lanes a, lanes b) { return _mm_add_pd(a, b); }
+inline lanes vsub(lanes a, lanes b) { return _mm_sub_pd(a, b); }
+inline lanes vmul(lanes a, lanes b) { return _mm_mul_pd(a, b); }
+inline lanes vdiv(lanes a, lanes b) { return _mm_div_pd(a, b); }
+inline lanes vsqrt(lanes a) { return _mm_sqrt_pd(a); }
+inline lanes vmin(lanes a, lanes b) { return _mm_min_pd(b, a); }
+inline lanes vmax(lanes a, lanes b) { return _mm_max_pd(b, a); }
+inline laneMask vlt(lanes a, lanes b) { return _mm_cmplt_pd(a, b); }
+inline laneMask vle(lanes a, lanes b) { return _mm_cmple_pd(a, b); }
+inline laneMask vgt(lanes a, lanes b) { return _mm_cmpgt_pd(a, b); }
+inline laneMask vand(laneMask a, laneMask b) { return _mm_and_pd(a, b); }
+inline laneMask vor(laneMask a, laneMask b) { return _mm_or_pd(a, b); }
+inline laneMask vandnot(laneMask a, laneMask b) { return _mm_andnot_pd(a, b); }
+inline laneMask vmask(bool a) { return _mm_castsi128_pd(_mm_set1_epi64x(a ? -1 : 0)); }
+inline lanes vselect(laneMask mask, lanes a, lanes b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+inline int vbits(laneMask mask) { return _mm_movemask_pd(mask); }
+
+#else
+
+#define simdWidth 1
+typedef double lanes;
+typedef bool laneMask;
+
+inline lanes vload(const double* p) { return *p; }
+inline void vstore(double* p, lanes a) { *p = a; }
+inline lanes vset(double a) { return a; }
+inline lanes vadd(lanes a, lanes b) { return a + b; }
+inline lanes vsub(lanes a, lanes b) { return a - b; }
+inline lanes vmul(lanes a, lanes b) { return a * b; }
+inline lanes vdiv(lanes a, lanes b) { return a / b; }
+inline lanes vsqrt(lanes a) { return sqrt(a); }
+inline lanes vmin(lanes a, lanes b) { return min(a, b); }
+inline lanes vmax(lanes a, lanes b) { return max(a, b); }
+inline laneMask vlt(lanes a, lanes b) { return a < b; }
+inline laneMask vle(lanes a, lanes b) { return a <= b; }
+inline laneMask vgt(lanes a, lanes b) { return a > b; }
+inline laneMask vand(laneMask a, laneMask b) { return a && b; }
+inline laneMask vor(laneMask a, laneMask b) { return a || b; }
+inline laneMask vandnot(laneMask a, laneMask b) { return !a && b; }
+inline laneMask vmask(bool a) { return a; }
+inline lanes vselect(laneMask mask, lanes a, lanes b) { return mask ? a : b; }
+inline int vbits(laneMask mask) { return mask; }
+
+#endif
+
+//camera rays traced together, one lane per ray, stored as separate arrays
+//per component so the kernels load simdWidth lanes at once
+struct RayPacket
+{
+    alignas(32) double ox[packetSize], oy[packetSize], oz[packetSize];
+    alignas(32) double dx[packetSize], dy[packetSize], dz[packetSize];
+    alignas(32) double ix[packetSize], iy[packetSize], iz[packetSize];    //1 / direction
+    alignas(32) double t[packetSize];     //closest hit so far, -1 in inactive lanes
+    int nearest[packetSize];
+    bool active[packetSize];
+    int activeBits;     //bit k set for an active lane k
+    Ray* rays;
+
+    //rays[0..count) fill the first lanes, the rest stay inactive
+    void load(Ray* rays, int count)
+    {
+        this->rays = rays;
+        activeBits = (1 << count) - 1;
+
+        for (int k = 0; k < packetSize; k++) {
+            Ray& ray = rays[k < count ? k : 0];
+
+            ox[k] = ray.start.x; oy[k] = ray.start.y; oz[k] = ray.start.z;
+            dx[k] = ray.dir.x; dy[k] = ray.dir.y; dz[k] = ray.dir.z;
+
+            //no hit is closer than -1, so the kernels never record one there
+            t[k] = k < count ? 9999999 : -1;
+            nearest[k] = -1;
+            active[k] = k < count;
+        }
+
+        lanes one = vset(1);
+        for (int k = 0; k < packetSize; k += simdWidth) {
+            vstore(ix + k, vdiv(one, vload(dx + k)));
+            vstore(iy + k, vdiv(one, vload(dy + k)));
+            vstore(iz + k, vdiv(one, vload(dz + k)));
+        }
+    }
+
+    //true if the box may hold a closer hit for at least one active lane
+    bool hitsBox(AABB& box)
+    {
+        lanes lox = vset(box.lo.x), loy = vset(box.lo.y), loz = vset(box.lo.z);
+        lanes hix = vset(box.hi.x), hiy = vset(box.hi.y), hiz = vset(box.hi.z);
+        lanes zero = vset(0);
+        int bits = 0;
+
+        for (int k = 0; k < packetSize; k += simdWidth) {
+            lanes x = vload(ox + k), y = vload(oy + k), z = vload(oz + k);
+            lanes inx = vload(ix + k), iny = vload(iy + k), inz = vload(iz + k);
+
+            lanes tx1 = vmul(vsub(lox, x), inx), tx2 = vmul(vsub(hix, x), inx);
+            lanes ty1 = vmul(vsub(loy, y), iny), ty2 = vmul(vsub(hiy, y), iny);
+            lanes tz1 = vmul(vsub(loz, z), inz), tz2 = vmul(vsub(hiz, z), inz);
+
+            lanes tEnter = vmax(vmax(vmin(tx1, tx2), vmin(ty1, ty2)), vmin(tz1, tz2));
+            lanes tExit = vmin(vmin(vmax(tx1, tx2), vmax(ty1, ty2)), vmax(tz1, tz2));
+
+            laneMask hit = vand(vand(vle(tEnter, tExit), vgt(tExit, zero)), vle(tEnter, vload(t + k)));
+            bits |= vbits(hit) << k;
+        }
+        return (bits & activeBits) != 0;
+    }
+
+    //keeps the closer of the lane's current hit and (tk, index)
+    void record(int k, double tk, int index)
+    {
+        if (active[k] && tk > 0 && tk < t[k]) {
+            t[k] = tk;
+            nearest[k] = index;
+        }
+    }
+
+    //record for the simdWidth lanes from k on
+    void recordLanes(int k, lanes tk, int index)
+    {
+        lanes current = vload(t + k);
+        laneMask closer = vand(vgt(tk, vset(0)), vlt(tk, current));
+
+        int bits = vbits(closer);
+        if (bits == 0) return;
+
+        vstore(t + k, vselect(closer, tk, current));
+        for (int m = 0; m < simdWidth; m++) {
+            if (bits >> m & 1) nearest[k + m] = index;
+        }
+    }
+
+    //rays diverge when some lane points away from the packet's mean direction
+    bool coherent(int count)
+    {
+        double mx = 0, my = 0, mz = 0;
+        for (int k = 0; k < count; k++) {
+            mx += dx[k]; my += dy[k]; mz += dz[k];
+        }
+
+        double m = sqrt(mx * mx + my * my + mz * mz);
+        if (m == 0) return false;
+
+        double limit = 0.99 * m;
+        for (int k = 0; k < count; k++) {
+            if (dx[k] * mx + dy[k] * my + dz[k] * mz < limit) return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define POINT_H
 
 #include <ostream>
+#include <algorithm>
 using namespace std;
 
 struct point
@@ -71,12 +72,67 @@ point operator * (double d, point& pt)
 struct Ray{
     point start;
     point dir;
+    double travelled;   //length of the path from the camera to start
 
-    Ray(point start, point dir)
+    Ray() {}
+    Ray(point start, point dir, double travelled = 0)
     {
         this->start = start;
         this->dir = dir;
         this->dir.normalize();
+        this->travelled = travelled;
+    }
+};
+
+//axis aligned bounding box
+struct AABB{
+    point lo, hi;
+
+    AABB()
+    {
+        lo = point(1e300, 1e300, 1e300);
+        hi = point(-1e300, -1e300, -1e300);
+    }
+    AABB(point lo, point hi)
+    {
+        this->lo = lo;
+        this->hi = hi;
+    }
+    void expand(point p)
+    {
+        lo = point(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+        hi = point(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+    }
+    void expand(AABB box)
+    {
+        expand(box.lo);
+        expand(box.hi);
+    }
+    bool overlaps(AABB& box)
+    {
+        return lo.x <= box.hi.x && box.lo.x <= hi.x && lo.y <= box.hi.y && box.lo.y <= hi.y
+               && lo.z <= box.hi.z && box.lo.z <= hi.z;
+    }
+    point center()
+    {
+        return (lo + hi) / 2.0;
+    }
+    double area()
+    {
+        point d = hi - lo;
+        return 2.0 * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+    //slab test, invDir = 1/ray.dir, true if [tEnter, tExit] overlaps (0, tMax]
+    bool hit(Ray* ray, point invDir, double tMax, double& tEnter)
+    {
+        double tx1 = (lo.x - ray->start.x) * invDir.x, tx2 = (hi.x - ray->start.x) * invDir.x;
+        double ty1 = (lo.y - ray->start.y) * invDir.y, ty2 = (hi.y - ray->start.y) * invDir.y;
+        double tz1 = (lo.z - ray->start.z) * invDir.z, tz2 = (hi.z - ray->start.z) * invDir.z;
+
+        tEnter = max(max(min(tx1, tx2), min(ty1, ty2)), min(tz1, tz2));
+        double tExit = min(min(max(tx1, tx2), max(ty1, ty2)), max(tz1, tz2));
+
+        return tEnter <= tExit && tExit > 0 && tEnter <= tMax;
     }
 };
 
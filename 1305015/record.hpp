@@ -0,0 +1,139 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "point.hpp"
+#include <vector>
+
+//length of a recorded ray that hits nothing
+#define farDistance 100000
+
+//a set of rays kept as boxes around their starts and directions plus the
+//longest of them, enough to tell conservatively whether any of them can meet a box
+struct RayBundle
+{
+    AABB starts, dirs;
+    double tMax;
+
+    void clear()
+    {
+        starts = dirs = AABB();
+        tMax = 0;
+    }
+
+    void add(Ray* ray, double t)
+    {
+        starts.expand(ray->start);
+        dirs.expand(ray->dir);
+        tMax = max(tMax, t);
+    }
+
+    //interval version of the slab test: every point of start + t * dir with
+    //t in [0, tMax] lies in starts + t * dirs
+    bool mayHit(AABB& box)
+    {
+        if (starts.lo.x > starts.hi.x) return false;
+
+        double tLo = 0, tHi = tMax;
+        double lo[3] = {starts.lo.x, starts.lo.y, starts.lo.z}, hi[3] = {starts.hi.x, starts.hi.y, starts.hi.z};
+        double dLo[3] = {dirs.lo.x, dirs.lo.y, dirs.lo.z}, dHi[3] = {dirs.hi.x, dirs.hi.y, dirs.hi.z};
+        double bLo[3] = {box.lo.x, box.lo.y, box.lo.z}, bHi[3] = {box.hi.x, box.hi.y, box.hi.z};
+
+        for (int a = 0; a < 3 && tLo <= tHi; a++) {
+            //lowest point of the bundle below the top of the box
+            if (dLo[a] > 0) tHi = min(tHi, (bHi[a] - lo[a]) / dLo[a]);
+            else if (dLo[a] < 0) tLo = max(tLo, (bHi[a] - lo[a]) / dLo[a]);
+            else if (lo[a] > bHi[a]) return false;
+
+            //highest point of the bundle above the bottom of the box
+            if (dHi[a] > 0) tLo = max(tLo, (bLo[a] - hi[a]) / dHi[a]);
+            else if (dHi[a] < 0) tHi = min(tHi, (bLo[a] - hi[a]) / dHi[a]);
+            else if (hi[a] < bLo[a]) return false;
+        }
+        return tLo <= tHi;
+    }
+};
+
+//what the rays of one tile touched, so an edit only has to trace the tiles it
+//can change again
+struct TileRecord
+{
+    vector<int> objects;    //hit or blocking a shadow ray, sorted once the tile is done
+    RayBundle camera;       //camera rays
+    RayBundle secondary;    //reflected and refracted rays
+    AABB hits;              //every hit point, the shadow rays start there
+
+    void clear()
+    {
+        objects.clear();
+        camera.clear();
+        secondary.clear();
+        hits = AABB();
+    }
+
+    void finish()
+    {
+        sort(objects.begin(), objects.end());
+        objects.erase(unique(objects.begin(), objects.end()), objects.end());
+    }
+
+    void addObject(int index)
+    {
+        //neighbouring rays mostly hit the same object, finish() drops the rest
+        if (objects.empty() || objects.back() != index) objects.push_back(index);
+    }
+
+    //true if a camera, secondary or shadow ray of the tile can meet box
+    bool mayHit(AABB& box, vector<point>& lights)
+    {
+        if (camera.mayHit(box) || secondary.mayHit(box)) return true;
+        if (hits.lo.x > hits.hi.x) return false;
+
+        //shadow rays, hit + t * (light - hit) for t in [0, 1]
+        for (int i = 0; i < lights.size(); i++) {
+            RayBundle shadows;
+            shadows.starts = hits;
+            shadows.dirs = AABB(lights[i] - hits.hi, lights[i] - hits.lo);
+            shadows.tMax = 1;
+
+            if (shadows.mayHit(box)) return true;
+        }
+        return false;
+    }
+};
+
+//record of the tile the calling thread traces, 0 while nothing is recorded
+thread_local TileRecord* tileRecord = 0;
+
+//camera rays are the ones starting at the camera
+point recordCamera;
+
+inline RayBundle& recordBundle(Ray* ray)
+{
+    bool camera = ray->start.x == recordCamera.x && ray->start.y == recordCamera.y && ray->start.z == recordCamera.z;
+    return camera ? tileRecord->camera : tileRecord->secondary;
+}
+
+inline void recordHit(Ray* ray, int index, double t, point position)
+{
+    if (tileRecord == 0) return;
+
+    tileRecord->addObject(index);
+    tileRecord->hits.expand(position);
+    recordBundle(ray).add(ray, t);
+}
+
+inline void recordMiss(Ray* ray)
+{
+    if (tileRecord == 0) return;
+
+    recordBundle(ray).add(ray, farDistance);
+}
+
+inline void recordOccluder(int index)
+{
+    if (tileRecord == 0) return;
+
+    tileRecord->addObject(index);
+}
+
+#endif
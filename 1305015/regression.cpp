@@ -0,0 +1,226 @@
+//golden image test, renders the reference scenes and compares them with stored images
+//build : g++ -O2 -std=c++11 -pthread regression.cpp -o regression
+//usage : regression [-golden golden] [-update] [-psnr 40] [-maxerror 24] [-size n] [-threads n]
+//
+//every scene is rendered with the scalar, the packet and the wavefront tracer
+//and all three are compared with golden/<scene>.bmp. a render fails when its
+//psnr drops below the limit or one channel of one pixel is off by more than
+//maxerror, the failed render and a difference image are written next to the
+//golden image. -update renders the golden images with the scalar tracer.
+//each tracer also renders an empty crop window of the first scene, streamed
+//and not, which must give an image without pixels
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<math.h>
+#include<sys/stat.h>
+
+#define HEADLESS
+
+#include "render.hpp"
+#include "test_scenes.hpp"
+
+using namespace std;
+
+//largest difference of one channel of one pixel, 256 if the sizes differ
+int maxChannelError(bitmap_image& a, bitmap_image& b)
+{
+    if (a.width() != b.width() || a.height() != b.height()) return 256;
+
+    int error = 0;
+    for (unsigned int y = 0; y < a.height(); y++) {
+        for (unsigned int x = 0; x < a.width(); x++) {
+            unsigned char r1, g1, b1, r2, g2, b2;
+            a.get_pixel(x, y, r1, g1, b1);
+            b.get_pixel(x, y, r2, g2, b2);
+
+            error = max(error, abs(r1 - r2));
+            error = max(error, abs(g1 - g2));
+            error = max(error, abs(b1 - b2));
+        }
+    }
+    return error;
+}
+
+//absolute difference per channel, scaled up so small errors stay visible
+void writeDifference(bitmap_image& a, bitmap_image& b, const string& fileName)
+{
+    bitmap_image difference(a.width(), a.height());
+
+    for (unsigned int y = 0; y < a.height(); y++) {
+        for (unsigned int x = 0; x < a.width(); x++) {
+            unsigned char r1, g1, b1, r2, g2, b2;
+            a.get_pixel(x, y, r1, g1, b1);
+            b.get_pixel(x, y, r2, g2, b2);
+
+            difference.set_pixel(x, y, min(255, 8 * abs(r1 - r2)), min(255, 8 * abs(g1 - g2)), min(255, 8 * abs(b1 - b2)));
+        }
+    }
+    difference.save_image(fileName);
+}
+
+//golden/scene.txt -> golden/scene
+string goldenName(const string& dir, const string& scene)
+{
+    return dir + "/" + scene.substr(0, scene.find('.'));
+}
+
+void render(const string& fileName)
+{
+    point u(0, 0, 1);
+    point r(1, 0, 0);
+    point l(0, 1, 0);
+    point pos(0, -100, 10);
+
+    renderScene(pos, u, r, l, fileName);
+    cout << endl;
+}
+
+//renders a crop window that lies outside the image, from the framebuffer and
+//streamed, with the loaded scene. each render must finish and write a bmp
+//header without pixels
+bool rendersEmptyCrop(const string& fileName)
+{
+    CropWindow outside = {imageWidth + 100, 0, 10, 10};
+    cropWindow = outside;
+
+    bool ok = true;
+    for (int stream = 0; stream < 2; stream++) {
+        streamOutput = stream == 1;
+        render(fileName);
+
+        ifstream in(fileName.c_str(), ios::binary | ios::ate);
+        ok &= in && in.tellg() == 54;
+        remove(fileName.c_str());
+    }
+
+    CropWindow whole = {0, 0, 0, 0};
+    cropWindow = whole;
+    streamOutput = false;
+    return ok;
+}
+
+void usage(const char* name)
+{
+    cout << "usage: " << name << " [-golden golden] [-update] [-psnr 40] [-maxerror 24] [-size n] [-threads n]" << endl;
+}
+
+int main(int argc, char **argv){
+
+    string goldenDir = "golden";
+    bool update = false;
+    double minPsnr = 40;
+    int maxError = 24;
+    int size = 256;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+
+        if (arg == "-golden" && i + 1 < argc) {
+            goldenDir = argv[++i];
+        } else if (arg == "-update") {
+            update = true;
+        } else if (arg == "-psnr" && i + 1 < argc) {
+            minPsnr = atof(argv[++i]);
+        } else if (arg == "-maxerror" && i + 1 < argc) {
+            maxError = atoi(argv[++i]);
+        } else if (arg == "-size" && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    statsFile = "";
+
+    vector<string> scenes;
+    scenes.push_back("floor");
+    scenes.push_back("scene.txt");
+    scenes.push_back("mirror");
+    scenes.push_back("stress1k");
+
+    const char* modeNames[] = {"scalar", "packets", "wavefront"};
+
+    if (update) {
+        mkdir(goldenDir.c_str(), 0755);
+    }
+
+    bool failed = false;
+    vector<string> report;
+
+    for (int i = 0; i < scenes.size(); i++) {
+        if (!loadTestScene(scenes[i])) {
+            cout << "cannot load " << scenes[i] << endl;
+            return 1;
+        }
+        imageWidth = imageHeight = size;
+
+        string golden = goldenName(goldenDir, scenes[i]);
+
+        if (update) {
+            wavefront = packets = false;
+            render(golden + ".bmp");
+            continue;
+        }
+
+        bitmap_image expected(golden + ".bmp");
+        if (!expected) {
+            report.push_back("no golden image for " + scenes[i] + ", run with -update first");
+            failed = true;
+            continue;
+        }
+
+        for (int mode = 0; mode < 3; mode++) {
+            packets = mode == 1;
+            wavefront = mode == 2;
+
+            string output = golden + "." + modeNames[mode] + ".bmp";
+            render(output);
+
+            bitmap_image actual(output);
+            double psnr = actual.psnr(expected);
+            int error = maxChannelError(actual, expected);
+            bool ok = psnr >= minPsnr && error <= maxError;
+
+            if (ok) {
+                remove(output.c_str());
+            } else if (error < 256) {
+                writeDifference(actual, expected, golden + "." + modeNames[mode] + ".diff.bmp");
+            }
+
+            //psnr() returns 1000000 for identical images
+            char line[128];
+            snprintf(line, sizeof(line), "%-12s %-10s %10.2f %10d%s", scenes[i].c_str(), modeNames[mode], min(psnr, 999.99), error, ok ? "" : "  FAILED");
+            report.push_back(line);
+
+            failed |= !ok;
+
+            //an empty crop once killed the streaming render with a division by zero
+            if (i == 0) {
+                bool cropOk = rendersEmptyCrop(golden + ".crop.bmp");
+
+                snprintf(line, sizeof(line), "%-12s %-10s %21s%s", "empty crop", modeNames[mode], cropOk ? "ok" : "", cropOk ? "" : "  FAILED");
+                report.push_back(line);
+
+                failed |= !cropOk;
+            }
+        }
+    }
+    freeMemory();
+
+    if (!update) {
+        printf("\n%-12s %-10s %10s %10s\n", "scene", "tracer", "psnr", "max error");
+    }
+    for (int i = 0; i < report.size(); i++) {
+        printf("%s\n", report[i].c_str());
+    }
+
+    if (update) {
+        cout << "golden images written to " << goldenDir << endl;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,606 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "scene.hpp"
+#include "scene_binary.hpp"
+#include "tile_pool.hpp"
+#include "wavefront.hpp"
+#include "bitmap_stream.hpp"
+#include "framebuffer.hpp"
+
+#define pi (2*acos(0.0))
+
+#define windowWidth 500
+#define windowHeight 500
+#define fov 80
+
+#define tileSize 32
+
+//trace tiles with the staged Wavefront integrator instead of one recursive pixel at a time
+bool wavefront = false;
+//find the camera ray hits packetSize rays at a time
+bool packets = false;
+//write finished rows of tiles straight into the output file instead of keeping the whole frame
+bool streamOutput = false;
+//adaptive anti-aliasing, up to aaSamples rays per pixel where the image has
+//edges, 1 keeps one ray through each pixel corner
+int aaSamples = 1;
+//color difference to a neighbour that marks an edge, and twice the error of a
+//refined pixel that ends its sampling
+double aaThreshold = 0.1;
+
+//samples added to an edge pixel before its colors are checked again
+#define aaRound 4
+
+//colors of the last capture, rows of the image top to bottom
+FrameBuffer frameBuffer;
+
+//with recordTiles set every traced tile fills its entry of tileRecords, in
+//the tile order of traceTiles
+bool recordTiles = false;
+vector<TileRecord> tileRecords;
+
+//part of the frame to render, in pixels from the top left corner of the full
+//image, the camera still covers the full image so a crop is an exact cut out
+struct CropWindow
+{
+    int x, y, width, height;
+};
+
+//zero width or height renders the whole image
+CropWindow cropWindow = {0, 0, 0, 0};
+
+//cropWindow clamped to the image
+CropWindow activeCrop()
+{
+    CropWindow crop = {0, 0, imageWidth, imageHeight};
+
+    if (cropWindow.width > 0 && cropWindow.height > 0) {
+        crop.x = max(0, min(cropWindow.x, imageWidth));
+        crop.y = max(0, min(cropWindow.y, imageHeight));
+        crop.width = min(cropWindow.x + cropWindow.width, imageWidth) - crop.x;
+        crop.height = min(cropWindow.y + cropWindow.height, imageHeight) - crop.y;
+    }
+    crop.width = max(crop.width, 0);
+    crop.height = max(crop.height, 0);
+    return crop;
+}
+
+//color seen along a camera ray
+point traceRay(Ray& r)
+{
+    countRay(primaryRays, 1);
+
+    double color[3];
+    Hit hit;
+
+    if(nearestHit(&r, hit)) {
+
+        hit.obj->shade(&r, hit, color, 1);
+
+        return point(color);
+    }
+    return point(0, 0, 0);
+}
+
+//color seen through one pixel corner
+point tracePixel(point pos, point cornerDir)
+{
+    Ray r(pos, cornerDir - pos);
+    return traceRay(r);
+}
+
+//colors[k] gets the color seen along rays[k], k < count <= packetSize; the
+//hits are found for the whole packet at once, the shading stays per ray
+void tracePacket(Ray* rays, int count, point* colors)
+{
+    RayPacket packet;
+    packet.load(rays, count);
+
+    if (!packet.coherent(count)) {
+        for (int k = 0; k < count; k++) {
+            colors[k] = traceRay(rays[k]);
+        }
+        return;
+    }
+
+    sceneBVH.nearestPacket(packet);
+
+    for (int k = 0; k < count; k++) {
+        countRay(primaryRays, 1);
+
+        colors[k] = point(0, 0, 0);
+        if (packet.nearest[k] == -1) {
+            recordMiss(&rays[k]);
+            continue;
+        }
+
+        double color[3];
+        Hit hit;
+        hit.t = packet.t[k];
+        hit.obj = objects[packet.nearest[k]];
+        hit.obj->fillHit(&rays[k], hit);
+        recordHit(&rays[k], packet.nearest[k], hit.t, hit.position);
+        hit.obj->shade(&rays[k], hit, color, 1);
+
+        colors[k] = point(color);
+    }
+}
+
+//k-th point of the radical inverse sequence in base b, in [0, 1)
+double radicalInverse(int k, int b)
+{
+    double f = 1, x = 0;
+    for (; k > 0; k /= b) {
+        f /= b;
+        x += f * (k % b);
+    }
+    return x;
+}
+
+//color of pixel (i, j) from up to aaSamples rays spread over the pixel area
+//around its corner, first is the color of the corner ray. samples come in
+//rounds of aaRound and stop once the mean is known to within aaThreshold / 2
+point refinePixel(point pos, point topLeft, point r, point u, double du, double dv, int i, int j, point first)
+{
+    //halton points shifted by a hash of the pixel, so neighbours do not share a pattern
+    unsigned int h = (i * 73856093u) ^ (j * 19349663u);
+    h = (h ^ (h >> 15)) * 2246822519u;
+    double shiftX = (h & 0xffff) / 65536.0, shiftY = (h >> 16) / 65536.0;
+
+    double sum[3] = {first.x, first.y, first.z};
+    double squares[3] = {first.x * first.x, first.y * first.y, first.z * first.z};
+    int n = 1;
+
+    while (n < aaSamples) {
+        for (int k = 0; k < aaRound && n < aaSamples; k++, n++) {
+            double x = fmod(radicalInverse(n, 2) + shiftX, 1.0) - 0.5;
+            double y = fmod(radicalInverse(n, 3) + shiftY, 1.0) - 0.5;
+
+            point c = tracePixel(pos, topLeft + r*(j + x)*du - u*(i + y)*dv);
+            double channels[3] = {c.x, c.y, c.z};
+            for (int a = 0; a < 3; a++) {
+                sum[a] += channels[a];
+                squares[a] += channels[a] * channels[a];
+            }
+        }
+
+        //squared standard error of the mean, worst channel
+        double error = 0;
+        for (int a = 0; a < 3; a++) {
+            double mean = sum[a] / n;
+            error = max(error, (squares[a] / n - mean * mean) / n);
+        }
+        if (error < aaThreshold * aaThreshold / 4) break;
+    }
+    return point(sum[0] / n, sum[1] / n, sum[2] / n);
+}
+
+//refines the edge pixels of a traced tile, an edge pixel differs from one of
+//its four neighbours by more than aaThreshold in some channel. neighbours just
+//outside the tile are traced as well, so a tile comes out the same whatever
+//tiles are traced around it
+void antialiasTile(point pos, point topLeft, point r, point u, double du, double dv,
+                   int iStart, int iEnd, int jStart, int jEnd, vector<point>& buffer)
+{
+    //the tile with a one pixel border, pixels off the image are not compared
+    int rows = iEnd - iStart + 2, columns = jEnd - jStart + 2;
+    vector<point> colors(rows * columns);
+    vector<bool> known(rows * columns, false);
+
+    for (int a = 0; a < rows; a++) {
+        for (int b = 0; b < columns; b++) {
+            int i = iStart - 1 + a, j = jStart - 1 + b;
+            bool border = a == 0 || a == rows - 1 || b == 0 || b == columns - 1;
+            bool corner = (a == 0 || a == rows - 1) && (b == 0 || b == columns - 1);
+
+            if (!border) {
+                colors[a * columns + b] = buffer[(i - iStart) * tileSize + (j - jStart)];
+            } else if (!corner && i >= 0 && i < imageHeight && j >= 0 && j < imageWidth) {
+                colors[a * columns + b] = tracePixel(pos, topLeft + r*j*du - u*i*dv);
+            } else {
+                continue;
+            }
+            known[a * columns + b] = true;
+        }
+    }
+
+    int neighbours[4] = {-columns, columns, -1, 1};
+
+    for (int a = 1; a < rows - 1; a++) {
+        for (int b = 1; b < columns - 1; b++) {
+            int p = a * columns + b;
+            point& c = colors[p];
+
+            double contrast = 0;
+            for (int k = 0; k < 4; k++) {
+                if (!known[p + neighbours[k]]) continue;
+                point d = colors[p + neighbours[k]] - c;
+                contrast = max(contrast, max(fabs(d.x), max(fabs(d.y), fabs(d.z))));
+            }
+
+            if (contrast > aaThreshold) {
+                int i = iStart - 1 + a, j = jStart - 1 + b;
+                buffer[(i - iStart) * tileSize + (j - jStart)] = refinePixel(pos, topLeft, r, u, du, dv, i, j, c);
+            }
+        }
+    }
+}
+
+//corner ray of pixel (i, j) of the full image goes through topLeft + r*j*du - u*i*dv
+void viewPlane(point pos, point u, point r, point l, point& topLeft, double& du, double& dv)
+{
+    double planeDistance = (windowHeight/2.0)/tan(fov*pi/360.0);
+
+    //the view widens with the image so pixels stay square
+    double planeWidth = windowWidth * (imageWidth * 1.0 / imageHeight);
+
+    topLeft = pos + l * planeDistance - r * planeWidth / 2.0 + u * windowHeight / 2.0;
+
+    du = planeWidth / imageWidth;
+    dv = (windowHeight * 1.0) / imageHeight;
+
+    pixelSpread = dv / planeDistance;
+}
+
+//traces the tiles of the crop window as seen from pos (u = up, r = right,
+//l = look), i counts rows and j columns of the full image. done gets every
+//finished tile, pixel (i, j) of it at buffer[(i - iStart) * tileSize + (j - jStart)].
+//colors of the pixels on every 2nd row and column of the crop window, x and y
+//count from the crop corner. a progressive render keeps what its previews
+//traced here in full precision, so the last level can reuse it and still
+//match a normal render
+struct TracedGrid
+{
+    vector<point> colors;
+    int width;
+
+    void resize(CropWindow crop)
+    {
+        width = (crop.width + 1) / 2;
+        colors.assign((size_t) width * ((crop.height + 1) / 2), point(0, 0, 0));
+    }
+
+    bool has(int y, int x)
+    {
+        return y % 2 == 0 && x % 2 == 0;
+    }
+
+    point& at(int y, int x)
+    {
+        return colors[(size_t) (y / 2) * width + x / 2];
+    }
+};
+
+//only the listed tiles are traced when there is a list. inOrder starts the
+//tiles row by row instead of giving every worker its own run of them. the
+//pixels of known are copied from it instead of traced again
+void traceTiles(point pos, point u, point r, point l, CropWindow crop,
+                const function<void(int tile, int iStart, int iEnd, int jStart, int jEnd, vector<point>& buffer)>& done,
+                vector<int>* only = 0, bool inOrder = false, TracedGrid* known = 0)
+{
+    point topLeft;
+    double du, dv;
+    viewPlane(pos, u, r, l, topLeft, du, dv);
+
+    int tileRows = (crop.height + tileSize - 1) / tileSize;
+    int tileColumns = (crop.width + tileSize - 1) / tileSize;
+
+    //one scratch tile per worker, handed to done once it is finished
+    vector< vector<point> > tileBuffers(numberOfThreads(), vector<point>(tileSize * tileSize));
+    vector<Wavefront> wavefronts(numberOfThreads());
+
+    if (recordTiles) {
+        tileRecords.resize(tileRows * tileColumns);
+        recordCamera = pos;
+    }
+
+    runParallel(only ? only->size() : tileRows * tileColumns, [&](int worker, int job) {
+
+        int tile = only ? (*only)[job] : job;
+        vector<point>& buffer = tileBuffers[worker];
+
+        if (recordTiles) {
+            tileRecord = &tileRecords[tile];
+            tileRecord->clear();
+        }
+
+        int iStart = crop.y + (tile / tileColumns) * tileSize;
+        int jStart = crop.x + (tile % tileColumns) * tileSize;
+        int iEnd = min(iStart + tileSize, crop.y + crop.height);
+        int jEnd = min(jStart + tileSize, crop.x + crop.width);
+
+        //copies pixel (i, j) into the tile if it is known already
+        auto reuse = [&](int i, int j) {
+            if (known == 0 || !known->has(i - crop.y, j - crop.x)) return false;
+            buffer[(i - iStart) * tileSize + (j - jStart)] = known->at(i - crop.y, j - crop.x);
+            return true;
+        };
+
+        if (wavefront) {
+            vector<Ray> cameraRays;
+            vector<int> slots;
+            vector<point> colors(tileSize * tileSize);
+
+            for (int i = iStart; i < iEnd; i++) {
+                for (int j = jStart; j < jEnd; j++) {
+                    if (reuse(i, j)) continue;
+
+                    point cornerDir = topLeft + r*j*du - u*i*dv;
+                    slots.push_back((i - iStart) * tileSize + (j - jStart));
+                    cameraRays.push_back(Ray(pos, cornerDir - pos));
+                }
+            }
+
+            wavefronts[worker].render(cameraRays, colors);
+
+            for (int p = 0; p < slots.size(); p++) {
+                buffer[slots[p]] = colors[p];
+            }
+        } else if (packets) {
+            //2x4 pixel blocks, the lanes of a block cut by the image edge stay empty
+            for (int i0 = iStart; i0 < iEnd; i0 += packetRows) {
+                for (int j0 = jStart; j0 < jEnd; j0 += packetColumns) {
+
+                    Ray rays[packetSize];
+                    int slot[packetSize];
+                    int count = 0;
+
+                    for (int i = i0; i < min(i0 + packetRows, iEnd); i++) {
+                        for (int j = j0; j < min(j0 + packetColumns, jEnd); j++) {
+                            if (reuse(i, j)) continue;
+
+                            point cornerDir = topLeft + r*j*du - u*i*dv;
+                            slot[count] = (i - iStart) * tileSize + (j - jStart);
+                            rays[count++] = Ray(pos, cornerDir - pos);
+                        }
+                    }
+
+                    if (count == 0) continue;
+
+                    point colors[packetSize];
+                    tracePacket(rays, count, colors);
+
+                    for (int k = 0; k < count; k++) {
+                        buffer[slot[k]] = colors[k];
+                    }
+                }
+            }
+        } else {
+            for (int i = iStart; i < iEnd; i++) {
+                for (int j = jStart; j < jEnd; j++) {
+                    if (reuse(i, j)) continue;
+
+                    point cornerDir = topLeft + r*j*du - u*i*dv;
+                    buffer[(i - iStart) * tileSize + (j - jStart)] = tracePixel(pos, cornerDir);
+                }
+            }
+        }
+
+        if (aaSamples > 1) {
+            antialiasTile(pos, topLeft, r, u, du, dv, iStart, iEnd, jStart, jEnd, buffer);
+        }
+
+        if (recordTiles) {
+            tileRecord->finish();
+            tileRecord = 0;
+        }
+
+        done(tile, iStart, iEnd, jStart, jEnd, buffer);
+    }, inOrder);
+}
+
+//traces the tiles of the crop window into frameBuffer, which already has the size of the crop
+void traceIntoFrameBuffer(point pos, point u, point r, point l, CropWindow crop, vector<int>* only = 0,
+                          TracedGrid* known = 0)
+{
+    traceTiles(pos, u, r, l, crop, [&](int tile, int iStart, int iEnd, int jStart, int jEnd, vector<point>& buffer) {
+        for (int i = iStart; i < iEnd; i++) {
+            for (int j = jStart; j < jEnd; j++) {
+                frameBuffer.set(i - crop.y, j - crop.x, buffer[(i - iStart) * tileSize + (j - jStart)]);
+            }
+        }
+    }, only, false, known);
+}
+
+//traces the crop window of the frame into frameBuffer, with a list of tiles
+//only those are traced again and the rest of the last frame is kept
+void renderToFrameBuffer(point pos, point u, point r, point l, vector<int>* only = 0)
+{
+    CropWindow crop = activeCrop();
+
+    if (only == 0) {
+        frameBuffer.resize(crop.width, crop.height);
+    }
+    traceIntoFrameBuffer(pos, u, r, l, crop, only);
+}
+
+//previews of a progressive render, from a grid of every 8th pixel down to every 2nd
+#define coarsestStep 8
+
+//traces the pixels of frameBuffer on the grid of every step-th row and column
+//that the coarser grid of every 2 * step-th one left out, and keeps them in known
+void traceGrid(point pos, point u, point r, point l, CropWindow crop, int step, TracedGrid& known)
+{
+    point topLeft;
+    double du, dv;
+    viewPlane(pos, u, r, l, topLeft, du, dv);
+
+    runParallel((crop.height + step - 1) / step, [&](int worker, int job) {
+        int y = job * step;
+
+        for (int x = 0; x < crop.width; x += step) {
+            bool traced = step < coarsestStep && y % (2 * step) == 0 && x % (2 * step) == 0;
+            if (traced) continue;
+
+            int i = crop.y + y, j = crop.x + x;
+            known.at(y, x) = tracePixel(pos, topLeft + r*j*du - u*i*dv);
+            frameBuffer.set(y, x, known.at(y, x));
+        }
+    });
+}
+
+//fills the pixels between the grid of every step-th pixel by bilinear
+//interpolation of the four grid pixels around them
+void fillGaps(int step)
+{
+    int lastRow = (frameBuffer.height - 1) / step * step;
+    int lastColumn = (frameBuffer.width - 1) / step * step;
+
+    runParallel(frameBuffer.height, [&](int worker, int y) {
+        int y0 = y / step * step, y1 = min(y0 + step, lastRow);
+        float fy = y1 > y0 ? (y - y0) / (float) step : 0;
+
+        for (int x = 0; x < frameBuffer.width; x++) {
+            if (y == y0 && x % step == 0) continue;
+
+            int x0 = x / step * step, x1 = min(x0 + step, lastColumn);
+            float fx = x1 > x0 ? (x - x0) / (float) step : 0;
+
+            float* a = frameBuffer.pixel(y0, x0);
+            float* b = frameBuffer.pixel(y0, x1);
+            float* c = frameBuffer.pixel(y1, x0);
+            float* d = frameBuffer.pixel(y1, x1);
+            float* p = frameBuffer.pixel(y, x);
+
+            for (int k = 0; k < 3; k++) {
+                p[k] = (a[k] * (1 - fx) + b[k] * fx) * (1 - fy) + (c[k] * (1 - fx) + d[k] * fx) * fy;
+            }
+        }
+    });
+}
+
+//progressive render of the crop window into frameBuffer: every 8th pixel is
+//traced first, then every 4th and 2nd, each level interpolates the gaps and
+//hands the preview to publish(step) as soon as it is done. the last level is
+//the normal tiled render of the pixels the previews left out, publish(1) gets
+//the finished frame
+void renderProgressive(point pos, point u, point r, point l, const function<void(int step)>& publish)
+{
+    CropWindow crop = activeCrop();
+    frameBuffer.resize(crop.width, crop.height);
+
+    TracedGrid known;
+    known.resize(crop);
+
+    for (int step = coarsestStep; step > 1; step /= 2) {
+        traceGrid(pos, u, r, l, crop, step, known);
+        fillGaps(step);
+        publish(step);
+    }
+
+    //the tiles replace the preview as they finish, a tile record needs every
+    //pixel's hits so recording traces them all again
+    traceIntoFrameBuffer(pos, u, r, l, crop, 0, recordTiles ? 0 : &known);
+    publish(1);
+}
+
+//saves buffer as a 24 bit bmp
+bool saveFrameBuffer(FrameBuffer& buffer, const string& fileName)
+{
+    BitmapStream stream;
+    if (!stream.open(fileName, buffer.width, buffer.height)) return false;
+
+    vector<unsigned char> row(3LL * buffer.width);
+
+    for (int i = 0; i < buffer.height; i++) {
+        for (int j = 0; j < buffer.width; j++) {
+            float* c = buffer.pixel(i, j);
+            setBGR(&row[3*j], c[0], c[1], c[2]);
+        }
+        stream.writeRows(i, 1, &row[0]);
+    }
+
+    if (!stream.close()) {
+        cout << "cannot write " << fileName << endl;
+        return false;
+    }
+    return true;
+}
+
+//traces the frame as seen from pos (u = up, r = right, l = look) and saves the
+//crop window of it as a bmp. with preview the frame is rendered progressively
+//and preview gets every level (see renderProgressive), there is no streaming then
+void renderScene(point pos, point u, point r, point l, const string& fileName,
+                 const function<void(int step)>* preview = 0)
+{
+    CropWindow crop = activeCrop();
+
+    BitmapStream stream;
+    bool streaming = streamOutput && preview == 0;
+
+    if (streaming && !stream.open(fileName, crop.width, crop.height)) return;
+
+    double renderStart = wallTime();
+    totalStats = RenderStats();
+
+    if (preview) {
+        renderProgressive(pos, u, r, l, *preview);
+    } else if (!streaming) {
+        renderToFrameBuffer(pos, u, r, l);
+    } else {
+        int tileColumns = (crop.width + tileSize - 1) / tileSize;
+
+        //streaming keeps only the rows of tiles still being traced, a row of tiles
+        //is written out and dropped as soon as its last tile is done. the tiles
+        //start in order, and a tile that would open a row too far below the
+        //first unfinished one waits, so a slow tile cannot pile up rows behind it
+        vector<int> tilesLeft((crop.height + tileSize - 1) / tileSize, tileColumns);
+        map< int, vector<unsigned char> > bands;
+        mutex bandLock;
+        condition_variable bandWritten;
+        int firstOpen = 0;
+        //an empty crop has no tiles at all, so nothing ever waits
+        int maxOpen = tileColumns > 0 ? numberOfThreads() / tileColumns + 2 : 1;
+
+        traceTiles(pos, u, r, l, crop, [&](int tile, int iStart, int iEnd, int jStart, int jEnd, vector<point>& buffer) {
+            int band = tile / tileColumns;
+            unsigned char* bgr;
+            {
+                unique_lock<mutex> guard(bandLock);
+                bandWritten.wait(guard, [&]() { return band < firstOpen + maxOpen; });
+
+                vector<unsigned char>& rows = bands[band];
+                rows.resize(3LL * crop.width * (iEnd - iStart));
+                bgr = &rows[0];
+            }
+
+            for (int i = iStart; i < iEnd; i++) {
+                for (int j = jStart; j < jEnd; j++) {
+                    point& c = buffer[(i - iStart) * tileSize + (j - jStart)];
+                    setBGR(bgr + 3LL * ((i - iStart) * crop.width + (j - crop.x)), c.x, c.y, c.z);
+                }
+            }
+
+            vector<unsigned char> done;
+            {
+                lock_guard<mutex> guard(bandLock);
+                if (--tilesLeft[band] == 0) {
+                    bands[band].swap(done);
+                    bands.erase(band);
+                }
+            }
+            if (!done.empty()) {
+                stream.writeRows(iStart - crop.y, iEnd - iStart, &done[0]);
+
+                lock_guard<mutex> guard(bandLock);
+                while (firstOpen < tilesLeft.size() && tilesLeft[firstOpen] == 0) firstOpen++;
+                bandWritten.notify_all();
+            }
+        }, 0, true);
+    }
+
+    renderTimes.render = wallTime() - renderStart;
+    double saveStart = wallTime();
+
+    if (!streaming) {
+        saveFrameBuffer(frameBuffer, fileName);
+    } else if (!stream.close()) {
+        cout << "cannot write " << fileName << endl;
+    }
+
+    renderTimes.save = wallTime() - saveStart;
+    writeStats(crop.width, crop.height, numberOfThreads());
+}
+
+#endif
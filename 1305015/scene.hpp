@@ -0,0 +1,230 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "base.hpp"
+#include "bvh.hpp"
+
+int imageWidth, imageHeight;
+int recursion_level;
+
+vector<object*> objects;
+vector<point> lights; //actually not point, vector
+
+//scene file text of every object loaded by loadScene, to tell which ones an edit changed
+vector<string> objectSources;
+
+//objects of binary scenes, one block per type and load instead of one heap
+//allocation each, objects points into them. freeMemory drops the blocks whole
+list< vector<sphere> > sphereBlocks;
+list< vector<Triangle> > triangleBlocks;
+list< vector<GeneralQuadratic> > generalBlocks;
+
+point crossProduct(point a, point b)
+{
+    point ret;
+    ret.x = a.y * b.z - a.z * b.y;
+    ret.y = a.z * b.x - a.x * b.z;
+    ret.z = a.x * b.y - a.y * b.x;
+    return ret;
+}
+
+double dotProduct(point a, point b) {
+    return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+//scene compile step, run once the objects are loaded: refreshes every object's
+//cached per ray data and builds the BVH over them
+void compileScene()
+{
+    double start = wallTime();
+
+    for (int i = 0; i < objects.size(); i++) {
+        objects[i]->compile();
+    }
+    sceneBVH.build(objects);
+
+    renderTimes.build = wallTime() - start;
+}
+
+//the checkered floor every scene stands on
+object* addFloor()
+{
+    object* temp = new Floor(1000, 20);
+    temp->setCoEfficients(0.4,0.2,0.2,0.2);
+    temp->setShine(1);
+    objects.push_back(temp);
+    return temp;
+}
+
+//first lines of a scene: recursion level, then the image size where a lone
+//width means a square image
+void readSceneHeader(istream& fin)
+{
+    fin>>recursion_level;
+    fin>>imageWidth;
+    string size;
+    getline(fin, size);
+    if (!(istringstream(size) >> imageHeight)) {
+        imageHeight = imageWidth;
+    }
+}
+
+//reads a scene in the scene.txt format from fin
+bool loadScene(istream& fin) {
+
+    double start = wallTime();
+
+    readSceneHeader(fin);
+
+    int numOfObjects;
+    fin>>numOfObjects;
+
+    string command;
+    double a, b, c, radius;
+
+    object *temp;
+
+    for (int i=0; i<numOfObjects; i++) {
+        fin>>command;
+
+        //the numbers of the object are read first and kept as its source text
+        int count = command == "sphere" ? 12 : command == "triangle" ? 17 : command == "general" ? 24 : 0;
+        string source = command, token;
+        for (int k = 0; k < count && fin>>token; k++) {
+            source += " " + token;
+        }
+        istringstream in(source);
+        in>>command;
+        if (count > 0) objectSources.push_back(source);
+
+        if (command == "sphere") {
+
+            in>>a>>b>>c;
+            point center(a, b, c);
+
+            in>>radius;
+            temp = new sphere(center, radius);
+
+            in>>a>>b>>c;
+            temp->setColor(a, b, c);
+
+            in>>a>>b>>c>>radius;
+            temp->setCoEfficients(a, b, c, radius);
+
+            in>>a;
+            temp->setShine(a);
+
+            objects.push_back(temp);
+        }
+
+        else if (command == "triangle") {
+
+            in>>a>>b>>c;
+            point A(a, b, c);
+
+            in>>a>>b>>c;
+            point B(a, b, c);
+
+            in>>a>>b>>c;
+            point C(a, b, c);
+
+            temp = new Triangle(A, B, C);
+
+            in>>a>>b>>c;
+            temp->setColor(a, b, c);
+
+            in>>a>>b>>c>>radius;
+            temp->setCoEfficients(a, b, c, radius);
+
+            in>>a;
+            temp->setShine(a);
+
+            objects.push_back(temp);
+
+        }
+
+        else if (command == "general") {
+
+            double coeff[10];
+            for (int c=0; c<10; c++) {
+                in>>coeff[c];
+            }
+
+            in>>a>>b>>c;
+            point reff(a, b, c);
+
+            in>>a>>b>>c;
+            temp = new GeneralQuadratic(coeff, reff, a, b, c);
+
+            in>>a>>b>>c;
+            temp->setColor(a, b, c);
+
+            in>>a>>b>>c>>radius;
+            temp->setCoEfficients(a, b, c, radius);
+
+            in>>a;
+            temp->setShine(a);
+
+            objects.push_back(temp);
+
+        }
+
+    }
+
+    fin>>numOfObjects;
+    for (int i=0; i<numOfObjects; i++) {
+        fin>>a>>b>>c;
+
+        point light(a, b, c);
+        lights.push_back(light);
+    }
+
+
+    addFloor();
+    objectSources.push_back("floor");
+
+    renderTimes.load = wallTime() - start;
+
+    compileScene();
+    return true;
+}
+
+//binary scenes, in scene_binary.hpp
+extern bool isBinaryScene(const unsigned char* data, size_t size);
+extern bool loadBinaryScene(const string& fileName);
+
+//loads a scene file in the scene.txt format or the binary one, told apart by
+//the first bytes
+bool loadActualData(const string& fileName = "scene.txt") {
+
+    ifstream fin(fileName.c_str(), ios::binary);
+    if(fin.is_open() == false)
+    {
+        cout << "very serious error";
+        return false;
+    }
+
+    unsigned char start[64];
+    fin.read((char*) start, sizeof(start));
+    if (isBinaryScene(start, fin.gcount())) {
+        return loadBinaryScene(fileName);
+    }
+    fin.clear();
+    fin.seekg(0);
+
+    return loadScene(fin);
+}
+
+void freeMemory() {
+    for (int i = 0; i < objects.size(); i++) {
+        if (!objects[i]->pooled) delete objects[i];
+    }
+    sphereBlocks.clear();
+    triangleBlocks.clear();
+    generalBlocks.clear();
+    vector<point>().swap(lights);
+    vector<object*>().swap(objects);
+    vector<string>().swap(objectSources);
+}
+
+#endif
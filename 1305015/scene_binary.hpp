@@ -0,0 +1,273 @@
+#ifndef SCENE_BINARY_H
+#define SCENE_BINARY_H
+
+#include "scene.hpp"
+#include "mapped_file.hpp"
+
+//binary scene format, for scenes too big to parse as text at every start.
+//the file is little endian and made of fixed size records, each array starts
+//on an 8 byte boundary so the loader reads the records in place:
+//
+//  SceneFileHeader
+//  SceneMaterial   materials
+//  SceneSphere     spheres
+//  SceneTriangle   triangles
+//  SceneGeneral    generals
+//  SceneLight      lights
+//
+//objects refer to their material by index, only materials of stored objects
+//are written. the floor is not stored, not even its material, every loader
+//adds it. loadActualData tells the formats apart by the magic
+#define sceneMagic "RTSCENE"
+#define sceneVersion 1
+
+struct SceneFileHeader
+{
+    char magic[8];              //sceneMagic and a zero
+    unsigned int version;
+    int recursionLevel, imageWidth, imageHeight;
+    unsigned int materials, spheres, triangles, generals, lights;
+    unsigned int reserved;
+};
+
+struct SceneMaterial
+{
+    double color[3];
+    double coefficients[4];     //ambient, diffuse, specular, reflection
+    double shine;
+};
+
+struct SceneSphere
+{
+    double center[3];
+    double radius;
+    unsigned int material, reserved;
+};
+
+struct SceneTriangle
+{
+    double a[3], b[3], c[3];
+    unsigned int material, reserved;
+};
+
+struct SceneGeneral
+{
+    double coefficients[10];    //A to J of the scene.txt format
+    double reference[3];
+    double length, width, height;
+    unsigned int material, reserved;
+};
+
+struct SceneLight
+{
+    double position[3];
+};
+
+static_assert(sizeof(SceneFileHeader) == 48 && sizeof(SceneMaterial) == 64 && sizeof(SceneSphere) == 40
+              && sizeof(SceneTriangle) == 80 && sizeof(SceneGeneral) == 136 && sizeof(SceneLight) == 24,
+              "the binary scene records must keep their size");
+
+bool isBinaryScene(const unsigned char* data, size_t size)
+{
+    return size >= sizeof(SceneFileHeader) && memcmp(data, sceneMagic, sizeof(sceneMagic)) == 0;
+}
+
+//gives an object of one of the blocks its material and adds it to the scene
+void addPooled(object* temp, const SceneMaterial& m)
+{
+    temp->setColor(m.color[0], m.color[1], m.color[2]);
+    temp->setCoEfficients(m.coefficients[0], m.coefficients[1], m.coefficients[2], m.coefficients[3]);
+    temp->setShine(m.shine);
+    temp->pooled = true;
+    objects.push_back(temp);
+}
+
+//builds the scene from a binary scene held in memory, name is only for the
+//messages. spheres, triangles and general quadrics are added in that order,
+//each type in one block
+bool loadBinaryScene(const unsigned char* data, size_t size, const string& name)
+{
+    double start = wallTime();
+
+    if (!isBinaryScene(data, size)) {
+        cout << name << " is not a binary scene" << endl;
+        return false;
+    }
+
+    const SceneFileHeader* header = (const SceneFileHeader*) data;
+    if (header->version != sceneVersion) {
+        cout << name << " has scene format version " << header->version << ", expected " << sceneVersion << endl;
+        return false;
+    }
+
+    size_t needed = sizeof(SceneFileHeader) + header->materials * sizeof(SceneMaterial)
+                    + header->spheres * sizeof(SceneSphere) + header->triangles * sizeof(SceneTriangle)
+                    + header->generals * sizeof(SceneGeneral) + header->lights * sizeof(SceneLight);
+    if (needed > size) {
+        cout << name << " is cut short" << endl;
+        return false;
+    }
+
+    const SceneMaterial* materials = (const SceneMaterial*) (header + 1);
+    const SceneSphere* spheres = (const SceneSphere*) (materials + header->materials);
+    const SceneTriangle* triangles = (const SceneTriangle*) (spheres + header->spheres);
+    const SceneGeneral* generals = (const SceneGeneral*) (triangles + header->triangles);
+    const SceneLight* sceneLights = (const SceneLight*) (generals + header->generals);
+
+    //every material index is checked before anything is built
+    bool valid = true;
+    for (unsigned int i = 0; i < header->spheres; i++) valid &= spheres[i].material < header->materials;
+    for (unsigned int i = 0; i < header->triangles; i++) valid &= triangles[i].material < header->materials;
+    for (unsigned int i = 0; i < header->generals; i++) valid &= generals[i].material < header->materials;
+    if (!valid) {
+        cout << name << " refers to a missing material" << endl;
+        return false;
+    }
+
+    recursion_level = header->recursionLevel;
+    imageWidth = header->imageWidth;
+    imageHeight = header->imageHeight;
+
+    //new blocks sized up front, so they never move once objects points into them
+    objects.reserve(objects.size() + header->spheres + header->triangles + header->generals + 1);
+
+    sphereBlocks.push_back(vector<sphere>());
+    triangleBlocks.push_back(vector<Triangle>());
+    generalBlocks.push_back(vector<GeneralQuadratic>());
+
+    vector<sphere>& sphereBlock = sphereBlocks.back();
+    vector<Triangle>& triangleBlock = triangleBlocks.back();
+    vector<GeneralQuadratic>& generalBlock = generalBlocks.back();
+
+    sphereBlock.reserve(header->spheres);
+    triangleBlock.reserve(header->triangles);
+    generalBlock.reserve(header->generals);
+
+    for (unsigned int i = 0; i < header->spheres; i++) {
+        const SceneSphere& s = spheres[i];
+        sphereBlock.emplace_back(point(s.center[0], s.center[1], s.center[2]), s.radius);
+        addPooled(&sphereBlock.back(), materials[s.material]);
+    }
+
+    for (unsigned int i = 0; i < header->triangles; i++) {
+        const SceneTriangle& t = triangles[i];
+        triangleBlock.emplace_back(point(t.a[0], t.a[1], t.a[2]), point(t.b[0], t.b[1], t.b[2]), point(t.c[0], t.c[1], t.c[2]));
+        addPooled(&triangleBlock.back(), materials[t.material]);
+    }
+
+    for (unsigned int i = 0; i < header->generals; i++) {
+        const SceneGeneral& g = generals[i];
+        double coeff[10];
+        copy(g.coefficients, g.coefficients + 10, coeff);
+        generalBlock.emplace_back(coeff, point(g.reference[0], g.reference[1], g.reference[2]), g.length, g.width, g.height);
+        addPooled(&generalBlock.back(), materials[g.material]);
+    }
+
+    for (unsigned int i = 0; i < header->lights; i++) {
+        const SceneLight& l = sceneLights[i];
+        lights.push_back(point(l.position[0], l.position[1], l.position[2]));
+    }
+
+    addFloor();
+
+    renderTimes.load = wallTime() - start;
+
+    compileScene();
+    return true;
+}
+
+//maps the file and builds the scene from it, the mapping is gone once the
+//objects are made
+bool loadBinaryScene(const string& fileName)
+{
+    MappedFile file;
+    if (!file.open(fileName)) return false;
+
+    return loadBinaryScene(file.data, file.size, fileName);
+}
+
+//writes the loaded scene in the binary format, objects with the same material
+//share one record
+bool saveBinaryScene(const string& fileName)
+{
+    SceneFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, sceneMagic, sizeof(sceneMagic));
+    header.version = sceneVersion;
+    header.recursionLevel = recursion_level;
+    header.imageWidth = imageWidth;
+    header.imageHeight = imageHeight;
+
+    vector<SceneMaterial> materials;
+    vector<SceneSphere> spheres;
+    vector<SceneTriangle> triangles;
+    vector<SceneGeneral> generals;
+    vector<SceneLight> sceneLights;
+    map<vector<double>, unsigned int> materialIndex;
+
+    for (int i = 0; i < objects.size(); i++) {
+        object* o = objects[i];
+
+        //the floor is added again by every loader, it gets no records at all
+        sphere* s = dynamic_cast<sphere*>(o);
+        Triangle* t = dynamic_cast<Triangle*>(o);
+        GeneralQuadratic* g = dynamic_cast<GeneralQuadratic*>(o);
+        if (!s && !t && !g) continue;
+
+        vector<double> key(o->color, o->color + 3);
+        key.insert(key.end(), o->co_efficients, o->co_efficients + 4);
+        key.push_back(o->shine);
+
+        map<vector<double>, unsigned int>::iterator found = materialIndex.find(key);
+        if (found == materialIndex.end()) {
+            SceneMaterial m;
+            copy(key.begin(), key.begin() + 3, m.color);
+            copy(key.begin() + 3, key.begin() + 7, m.coefficients);
+            m.shine = key[7];
+
+            found = materialIndex.insert(make_pair(key, (unsigned int) materials.size())).first;
+            materials.push_back(m);
+        }
+        unsigned int material = found->second;
+
+        if (s) {
+            SceneSphere record = {{s->reference_point.x, s->reference_point.y, s->reference_point.z}, s->length, material, 0};
+            spheres.push_back(record);
+        } else if (t) {
+            SceneTriangle record = {{t->a.x, t->a.y, t->a.z}, {t->b.x, t->b.y, t->b.z}, {t->c.x, t->c.y, t->c.z}, material, 0};
+            triangles.push_back(record);
+        } else {
+            SceneGeneral record = {{g->A, g->B, g->C, g->D, g->E, g->F, g->G, g->H, g->I, g->J},
+                                   {g->reference_point.x, g->reference_point.y, g->reference_point.z},
+                                   g->length, g->width, g->height, material, 0};
+            generals.push_back(record);
+        }
+    }
+
+    for (int i = 0; i < lights.size(); i++) {
+        SceneLight record = {{lights[i].x, lights[i].y, lights[i].z}};
+        sceneLights.push_back(record);
+    }
+
+    header.materials = materials.size();
+    header.spheres = spheres.size();
+    header.triangles = triangles.size();
+    header.generals = generals.size();
+    header.lights = sceneLights.size();
+
+    ofstream out(fileName.c_str(), ios::binary);
+    out.write((const char*) &header, sizeof(header));
+    if (!materials.empty()) out.write((const char*) &materials[0], materials.size() * sizeof(SceneMaterial));
+    if (!spheres.empty()) out.write((const char*) &spheres[0], spheres.size() * sizeof(SceneSphere));
+    if (!triangles.empty()) out.write((const char*) &triangles[0], triangles.size() * sizeof(SceneTriangle));
+    if (!generals.empty()) out.write((const char*) &generals[0], generals.size() * sizeof(SceneGeneral));
+    if (!sceneLights.empty()) out.write((const char*) &sceneLights[0], sceneLights.size() * sizeof(SceneLight));
+
+    if (!out) {
+        cout << "cannot write " << fileName << endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
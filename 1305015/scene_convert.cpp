@@ -0,0 +1,48 @@
+//writes a scene in the binary format of scene_binary.hpp, which every program
+//loads by mapping the file instead of parsing text
+//build : g++ -O2 -std=c++11 -pthread scene_convert.cpp -o scene_convert
+//usage : scene_convert scene.txt scene.bin
+//        the input may also name a test scene, stress1m for example
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<math.h>
+
+#define HEADLESS
+
+#include "render.hpp"
+#include "test_scenes.hpp"
+
+using namespace std;
+
+int main(int argc, char **argv){
+
+    if (argc != 3) {
+        cout << "usage: " << argv[0] << " scene.txt scene.bin" << endl;
+        return 1;
+    }
+
+    //the bvh build is timed apart from the load, it happens for both formats
+    double start = wallTime();
+    if (!loadTestScene(argv[1])) {
+        return 1;
+    }
+    double loaded = wallTime() - start - renderTimes.build;
+
+    if (!saveBinaryScene(argv[2])) {
+        return 1;
+    }
+
+    //read back at once, so a broken file is found here and not when rendering
+    freeMemory();
+    if (!loadActualData(argv[2])) {
+        return 1;
+    }
+
+    //the floor is not stored
+    cout << argv[2] << ": " << objects.size() - 1 << " objects, " << lights.size() << " lights, loaded in "
+         << renderTimes.load << " s instead of " << loaded << " s" << endl;
+
+    freeMemory();
+    return 0;
+}
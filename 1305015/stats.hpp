@@ -0,0 +1,129 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#define maxStatLevel 16
+
+enum RayType { primaryRays, shadowRays, reflectionRays, refractionRays, rayTypes };
+
+const char* rayTypeNames[rayTypes] = {"primary", "shadow", "reflection", "refraction"};
+
+enum PrimitiveType { spherePrimitive, floorPrimitive, trianglePrimitive, quadricPrimitive, primitiveTypes };
+
+const char* primitiveTypeNames[primitiveTypes] = {"sphere", "floor", "triangle", "general"};
+
+//counters of one render, kept per thread while tracing and summed up afterwards
+struct RenderStats
+{
+    long long rays[rayTypes];
+    long long raysPerLevel[maxStatLevel];   //by recursion level, 1 = camera rays
+    long long tests[primitiveTypes];        //ray - primitive intersection tests
+    long long bvhNodesVisited;
+
+    void add(RenderStats& other)
+    {
+        for (int i = 0; i < rayTypes; i++) rays[i] += other.rays[i];
+        for (int i = 0; i < maxStatLevel; i++) raysPerLevel[i] += other.raysPerLevel[i];
+        for (int i = 0; i < primitiveTypes; i++) tests[i] += other.tests[i];
+        bvhNodesVisited += other.bvhNodesVisited;
+    }
+};
+
+//no constructor, so the thread locals stay plain zero initialised data
+thread_local RenderStats threadStats;
+
+RenderStats totalStats;
+mutex totalStatsLock;
+
+inline void countRay(int type, int level)
+{
+    threadStats.rays[type]++;
+    threadStats.raysPerLevel[min(level, maxStatLevel - 1)]++;
+}
+
+inline void countTest(int primitive, int n = 1)
+{
+    threadStats.tests[primitive] += n;
+}
+
+inline void countNode()
+{
+    threadStats.bvhNodesVisited++;
+}
+
+//moves the calling thread's counters into totalStats
+void flushStats()
+{
+    lock_guard<mutex> guard(totalStatsLock);
+    totalStats.add(threadStats);
+    threadStats = RenderStats();
+}
+
+//wall clock times in seconds of the last load, build, render and save
+struct RenderTimes
+{
+    double load, build, render, save;
+};
+
+RenderTimes renderTimes;
+
+double wallTime()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//json report of the last capture, empty file name to skip it
+string statsFile = "stats.json";
+
+void writeStats(int width, int height, int threads)
+{
+    if (statsFile.empty()) return;
+
+    ofstream out(statsFile.c_str());
+    if (!out.is_open()) {
+        cout << "cannot write " << statsFile << endl;
+        return;
+    }
+
+    RenderStats& s = totalStats;
+    long long totalRays = 0;
+    for (int i = 0; i < rayTypes; i++) totalRays += s.rays[i];
+
+    out << "{\n";
+    out << "  \"width\": " << width << ",\n";
+    out << "  \"height\": " << height << ",\n";
+    out << "  \"threads\": " << threads << ",\n";
+
+    out << "  \"time\": {\"load\": " << renderTimes.load << ", \"build\": " << renderTimes.build
+        << ", \"render\": " << renderTimes.render << ", \"save\": " << renderTimes.save << "},\n";
+
+    out << "  \"rays\": {";
+    for (int i = 0; i < rayTypes; i++) {
+        out << "\"" << rayTypeNames[i] << "\": " << s.rays[i] << ", ";
+    }
+    out << "\"total\": " << totalRays << "},\n";
+
+    int deepest = maxStatLevel - 1;
+    while (deepest > 1 && s.raysPerLevel[deepest] == 0) deepest--;
+
+    out << "  \"rays_per_level\": [";
+    for (int i = 1; i <= deepest; i++) {
+        out << (i > 1 ? ", " : "") << s.raysPerLevel[i];
+    }
+    out << "],\n";
+
+    out << "  \"intersection_tests\": {";
+    for (int i = 0; i < primitiveTypes; i++) {
+        out << (i > 0 ? ", " : "") << "\"" << primitiveTypeNames[i] << "\": " << s.tests[i];
+    }
+    out << "},\n";
+
+    out << "  \"bvh_nodes_visited\": " << s.bvhNodesVisited << ",\n";
+    out << "  \"primary_rays_per_pixel\": " << (width * height > 0 ? s.rays[primaryRays] * 1.0 / width / height : 0) << ",\n";
+    out << "  \"mrays_per_second\": " << (renderTimes.render > 0 ? totalRays / renderTimes.render / 1e6 : 0) << "\n";
+    out << "}\n";
+}
+
+#endif
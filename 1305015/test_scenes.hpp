@@ -0,0 +1,118 @@
+#ifndef TEST_SCENES_H
+#define TEST_SCENES_H
+
+#include "scene.hpp"
+
+//scenes built in code for the benchmark and the image tests, every one of them
+//replaces the loaded scene and leaves it compiled, like loadActualData() does
+
+//nothing but the textured floor under one light
+void floorOnlyScene()
+{
+    freeMemory();
+    recursion_level = 3;
+
+    lights.push_back(point(0, 100, 100));
+    addFloor();
+
+    compileScene();
+}
+
+//two almost perfect mirrors facing each other with the camera in between,
+//every ray bounces until recursion_level runs out
+void mirrorScene()
+{
+    freeMemory();
+    recursion_level = 12;
+
+    object* temp;
+
+    temp = new sphere(point(0, 150, 40), 80);
+    temp->setColor(0.8, 0.8, 0.8);
+    temp->setCoEfficients(0.05, 0.05, 0.1, 0.9);
+    temp->setShine(30);
+    objects.push_back(temp);
+
+    temp = new sphere(point(0, -400, 40), 250);
+    temp->setColor(0.8, 0.8, 0.8);
+    temp->setCoEfficients(0.05, 0.05, 0.1, 0.9);
+    temp->setShine(30);
+    objects.push_back(temp);
+
+    temp = new sphere(point(-40, 40, 15), 12);
+    temp->setColor(1, 0, 0);
+    temp->setCoEfficients(0.4, 0.3, 0.1, 0.2);
+    temp->setShine(10);
+    objects.push_back(temp);
+
+    temp = new sphere(point(40, 40, 15), 12);
+    temp->setColor(0, 0, 1);
+    temp->setCoEfficients(0.4, 0.3, 0.1, 0.2);
+    temp->setShine(10);
+    objects.push_back(temp);
+
+    lights.push_back(point(70, 0, 120));
+    lights.push_back(point(-70, 0, 120));
+    addFloor();
+
+    compileScene();
+}
+
+//count random primitives, half spheres and half triangles, spread over the
+//view in front of the default camera and shrunk so the coverage stays alike
+void stressScene(int count)
+{
+    freeMemory();
+    recursion_level = 2;
+
+    mt19937 random(1305015);
+    uniform_real_distribution<double> unit(0, 1);
+
+    double size = 4 * cbrt(1000.0 / count);
+
+    objects.reserve(count + 1);
+
+    for (int i = 0; i < count; i++) {
+        point center(-250 + 500 * unit(random), 500 * unit(random), 1 + 100 * unit(random));
+
+        object* temp;
+        if (i % 2 == 0) {
+            temp = new sphere(center, size * (0.5 + unit(random)));
+        } else {
+            temp = new Triangle(center, center + point(2 * size, 0, 0), center + point(0, size, 2 * size));
+        }
+
+        temp->setColor(unit(random), unit(random), unit(random));
+        temp->setCoEfficients(0.4, 0.2, 0.2, 0.2);
+        temp->setShine(10);
+        objects.push_back(temp);
+    }
+
+    lights.push_back(point(70, 70, 70));
+    lights.push_back(point(-70, 70, 70));
+    addFloor();
+
+    compileScene();
+}
+
+//loads a scene built above by its name, any other name is read as a scene file
+bool loadTestScene(const string& name)
+{
+    if (name == "floor") {
+        floorOnlyScene();
+    } else if (name == "mirror") {
+        mirrorScene();
+    } else if (name == "stress1k") {
+        stressScene(1000);
+    } else if (name == "stress100k") {
+        stressScene(100000);
+    } else if (name == "stress1m") {
+        stressScene(1000000);
+    } else {
+        freeMemory();
+        return loadActualData(name);
+    }
+    return true;
+}
+
+#endif
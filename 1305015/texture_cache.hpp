@@ -0,0 +1,180 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <bits/stdc++.h>
+#include "bitmap_view.hpp"
+using namespace std;
+
+//side of the square blocks of a TiledImage is 1 << texelTileBits texels
+#define texelTileBits 3
+#define texelTile (1 << texelTileBits)
+
+//texels packed as 0x00bbggrr and stored in texelTile x texelTile blocks, one
+//block after the other, so the four texels of a bilinear lookup and its
+//neighbours on the floor mostly share a few cache lines. x and y are the
+//same as for bitmap_image::get_pixel
+struct TiledImage
+{
+    vector<unsigned int> texels;
+    int width, height;
+    int tilesAcross;
+
+    TiledImage(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        tilesAcross = (width + texelTile - 1) / texelTile;
+
+        int tilesDown = (height + texelTile - 1) / texelTile;
+        texels.assign((size_t) tilesAcross * tilesDown * texelTile * texelTile, 0);
+    }
+
+    //reads the rows of the view once, nothing else of the file is copied
+    TiledImage(const BitmapView& image) : TiledImage(image.width, image.height)
+    {
+        for (int y = 0; y < height; y++) {
+            const unsigned char* bgr = image.row(y);
+            for (int x = 0; x < width; x++, bgr += 3) {
+                texels[index(x, y)] = bgr[2] | (bgr[1] << 8) | (bgr[0] << 16);
+            }
+        }
+    }
+
+    size_t index(unsigned int x, unsigned int y) const
+    {
+        size_t tile = (size_t) (y >> texelTileBits) * tilesAcross + (x >> texelTileBits);
+        return (tile << (2 * texelTileBits)) + ((y & (texelTile - 1)) << texelTileBits) + (x & (texelTile - 1));
+    }
+
+    unsigned int at(unsigned int x, unsigned int y) const
+    {
+        return texels[index(x, y)];
+    }
+
+    //next level of the pyramid: every texel is the average of the 2x2 texels
+    //it covers, at an odd edge of the 2x1 or 1x1 texels left there
+    TiledImage half() const
+    {
+        TiledImage result((width + 1) / 2, (height + 1) / 2);
+
+        for (int y = 0; y < result.height; y++) {
+            int y0 = 2 * y, y1 = min(2 * y + 1, height - 1);
+
+            for (int x = 0; x < result.width; x++) {
+                int x0 = 2 * x, x1 = min(2 * x + 1, width - 1);
+                unsigned int corners[4] = {at(x0, y0), at(x1, y0), at(x0, y1), at(x1, y1)};
+
+                unsigned int texel = 0;
+                for (int shift = 0; shift < 24; shift += 8) {
+                    unsigned int sum = 0;
+                    for (int k = 0; k < 4; k++) sum += (corners[k] >> shift) & 0xff;
+                    texel |= (sum / 4) << shift;
+                }
+                result.texels[result.index(x, y)] = texel;
+            }
+        }
+        return result;
+    }
+};
+
+//a texture with its mip pyramid, every level half the size of the one before
+//down to 1x1, built once when the file is loaded. a file that cannot be read
+//gives a single empty level
+struct MipTexture
+{
+    vector<TiledImage> levels;
+
+    MipTexture(const string& fileName)
+    {
+        BitmapView image;
+        image.open(fileName);
+        levels.push_back(TiledImage(image));
+
+        while (levels.back().width > 1 || levels.back().height > 1) {
+            levels.push_back(levels.back().half());
+        }
+    }
+
+    unsigned int width() const
+    {
+        return levels[0].width;
+    }
+
+    unsigned int height() const
+    {
+        return levels[0].height;
+    }
+
+    //bilinear filter of one level at (x, y) in texels of that level, texel
+    //centres sit at .5, the border texels repeat outwards
+    void bilinear(int level, double x, double y, double rgb[3]) const
+    {
+        const TiledImage& image = levels[level];
+        int w = image.width, h = image.height;
+
+        x -= 0.5;
+        y -= 0.5;
+        int x0 = floor(x), y0 = floor(y);
+        double fx = x - x0, fy = y - y0;
+
+        int xs[2] = {max(0, min(x0, w - 1)), max(0, min(x0 + 1, w - 1))};
+        int ys[2] = {max(0, min(y0, h - 1)), max(0, min(y0 + 1, h - 1))};
+        double weights[4] = {(1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy};
+
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        for (int k = 0; k < 4; k++) {
+            unsigned int texel = image.at(xs[k % 2], ys[k / 2]);
+            rgb[0] += weights[k] * (texel & 0xff);
+            rgb[1] += weights[k] * ((texel >> 8) & 0xff);
+            rgb[2] += weights[k] * ((texel >> 16) & 0xff);
+        }
+    }
+
+    //trilinear sample at (x, y) in texels of the full size image, averaged over
+    //a footprint of width texels: bilinear in the two levels whose texels are
+    //closest to that width, blended by where the width falls between them.
+    //rgb is in 0..255 like get_pixel
+    void sample(double x, double y, double width, double rgb[3]) const
+    {
+        if (levels[0].width == 0) {
+            rgb[0] = rgb[1] = rgb[2] = 0;
+            return;
+        }
+
+        int last = levels.size() - 1;
+        double lod = min(log2(max(width, 1.0)), (double) last);
+        int level = min((int) lod, last);
+        double f = lod - level;
+
+        double scale = 1.0 / (1 << level);
+        bilinear(level, x * scale, y * scale, rgb);
+
+        if (f > 0 && level < last) {
+            double coarser[3];
+            bilinear(level + 1, x * scale / 2, y * scale / 2, coarser);
+            for (int k = 0; k < 3; k++) {
+                rgb[k] = rgb[k] * (1 - f) + coarser[k] * f;
+            }
+        }
+    }
+};
+
+//textures by file name: a file is read on the first request, then every object
+//asking for it shares that one copy read only until the program ends, also
+//across scene reloads
+map<string, MipTexture> textureCache;
+mutex textureCacheLock;
+
+const MipTexture* loadTexture(const string& fileName)
+{
+    lock_guard<mutex> guard(textureCacheLock);
+
+    map<string, MipTexture>::iterator texture = textureCache.find(fileName);
+    if (texture == textureCache.end()) {
+        //built in place, copying would duplicate every level
+        texture = textureCache.emplace(piecewise_construct, forward_as_tuple(fileName), forward_as_tuple(fileName)).first;
+    }
+    return &texture->second;
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef TILE_POOL_H
+#define TILE_POOL_H
+
+#include "stats.hpp"
+
+//number of worker threads, 0 means one per core
+int threadCount = 0;
+
+int numberOfThreads()
+{
+    if (threadCount > 0) return threadCount;
+
+    int cores = thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+//work stealing scheduler: every worker owns a deque of jobs, takes work from
+//its back and, once it runs dry, steals from the front of the other deques.
+//an ordered pool hands the jobs out in index order from one shared counter
+//instead, so the jobs in flight are always neighbours
+struct TilePool
+{
+    vector< deque<int> > queues;
+    vector<mutex> locks;
+    bool ordered;
+    atomic<int> nextJob;
+    int jobs;
+
+    TilePool(int workers, int jobs, bool ordered) : queues(workers), locks(workers), ordered(ordered), nextJob(0), jobs(jobs)
+    {
+        if (ordered) return;
+
+        //hand out contiguous runs so neighbouring tiles stay on one core
+        for (int i = 0; i < jobs; i++) {
+            queues[(long long) i * workers / jobs].push_back(i);
+        }
+    }
+
+    bool next(int worker, int& job)
+    {
+        if (ordered) {
+            job = nextJob++;
+            return job < jobs;
+        }
+
+        {
+            lock_guard<mutex> guard(locks[worker]);
+            if (!queues[worker].empty()) {
+                job = queues[worker].back();
+                queues[worker].pop_back();
+                return true;
+            }
+        }
+
+        for (int k = 1; k < queues.size(); k++) {
+            int victim = (worker + k) % queues.size();
+
+            lock_guard<mutex> guard(locks[victim]);
+            if (!queues[victim].empty()) {
+                job = queues[victim].front();
+                queues[victim].pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+//runs job(worker, index) for every index in [0, jobs) on numberOfThreads() threads,
+//ordered starts the jobs in index order
+void runParallel(int jobs, const function<void(int, int)>& job, bool ordered = false)
+{
+    int workers = min(numberOfThreads(), max(jobs, 1));
+
+    TilePool pool(workers, jobs, ordered);
+
+    auto work = [&](int worker) {
+        int index;
+        while (pool.next(worker, index)) {
+            job(worker, index);
+        }
+        flushStats();
+    };
+
+    vector<thread> threads;
+    for (int w = 1; w < workers; w++) {
+        threads.push_back(thread(work, w));
+    }
+    work(0);
+
+    for (int w = 0; w < threads.size(); w++) {
+        threads[w].join();
+    }
+}
+
+#endif
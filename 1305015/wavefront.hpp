@@ -0,0 +1,168 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "scene.hpp"
+
+//non recursive integrator: the rays of a whole tile move through the
+//intersect, shade and shadow stages together, one bounce at a time
+
+//one shaded hit, its color is folded into the parent once all bounces are done
+struct PathNode
+{
+    int parent;         //-1 for a camera hit
+    int pixel;          //pixel of a camera hit
+    double weight;      //factor on the parent, reflection or refraction coefficient
+    double color[3];
+};
+
+struct QueuedRay
+{
+    Ray ray;
+    int parent;         //node that spawned it, -1 for camera rays
+    int pixel;
+    int level;
+    double weight;
+};
+
+struct ShadowRay
+{
+    Ray ray;
+    double len;
+    int light;
+    int node;
+    double light_color[3];  //added to the node when nothing blocks the light
+};
+
+struct Wavefront
+{
+    vector<PathNode> nodes;
+    vector<QueuedRay> primaryQueue, reflectionQueue, refractionQueue;
+    vector<QueuedRay> nextReflectionQueue, nextRefractionQueue;
+    vector<ShadowRay> shadowQueue;
+    vector<Hit> hits;
+
+    //intersect every ray of the queue, shade the hits into new nodes and
+    //queue their shadow, reflection and refraction rays
+    void intersectAndShade(vector<QueuedRay>& queue, vector<QueuedRay>& nextReflections, vector<QueuedRay>& nextRefractions)
+    {
+        hits.resize(queue.size());
+
+        for (int q = 0; q < queue.size(); q++) {
+            if (!nearestHit(&queue[q].ray, hits[q])) {
+                hits[q].obj = 0;
+            }
+        }
+
+        for (int q = 0; q < queue.size(); q++) {
+            if (hits[q].obj == 0) continue;
+
+            QueuedRay& qr = queue[q];
+            Hit& hit = hits[q];
+            object* obj = hit.obj;
+
+            int index = nodes.size();
+            nodes.push_back(PathNode());
+            PathNode& node = nodes.back();
+            node.parent = qr.parent;
+            node.pixel = qr.pixel;
+            node.weight = qr.weight;
+
+            double surfaceColor[3];
+            obj->getSurfaceColor(hit, surfaceColor, node.color);
+
+            point reflection = obj->getReflection(&qr.ray, hit.normal);
+
+            for (int i = 0; i < lights.size(); i++) {
+
+                double len;
+                Ray L = obj->getShadowRay(hit.position, i, len);
+                countRay(shadowRays, qr.level);
+
+                ShadowRay sr = {L, len, i, index, {0, 0, 0}};
+                obj->addLight(&qr.ray, L, hit.normal, reflection, surfaceColor, sr.light_color);
+
+                shadowQueue.push_back(sr);
+            }
+
+            if (qr.level < recursion_level) {
+
+                QueuedRay next = {Ray(hit.position + reflection * 1.0, reflection, qr.ray.travelled + hit.t), index, qr.pixel, qr.level + 1, obj->co_efficients[3]};
+                nextReflections.push_back(next);
+                countRay(reflectionRays, qr.level + 1);
+
+                point refraction = obj->getRefraction(&qr.ray, hit.normal);
+
+                if (obj->hasRefraction(refraction)) {
+                    QueuedRay next = {Ray(hit.position + refraction * 1.0, refraction, qr.ray.travelled + hit.t), index, qr.pixel, qr.level + 1, obj->refracting_index};
+                    nextRefractions.push_back(next);
+                    countRay(refractionRays, qr.level + 1);
+                }
+            }
+        }
+
+        queue.clear();
+    }
+
+    void traceShadows()
+    {
+        for (int s = 0; s < shadowQueue.size(); s++) {
+            ShadowRay& sr = shadowQueue[s];
+
+            if (!occluded(&sr.ray, sr.len, sr.light)) {
+                for (int k = 0; k < 3; k++) {
+                    nodes[sr.node].color[k] += sr.light_color[k];
+                }
+            }
+        }
+        shadowQueue.clear();
+    }
+
+    //children always come after their parent, so walking backwards folds every
+    //subtree before its root, clamping each node like the recursive shade() does
+    void resolve(vector<point>& pixels)
+    {
+        for (int n = nodes.size() - 1; n >= 0; n--) {
+            PathNode& node = nodes[n];
+
+            for (int k = 0; k < 3; k++) {
+                node.color[k] = min(1.0, max(0.0, node.color[k]));
+            }
+
+            if (node.parent == -1) {
+                pixels[node.pixel] = point(node.color);
+            } else {
+                for (int k = 0; k < 3; k++) {
+                    nodes[node.parent].color[k] += node.color[k] * node.weight;
+                }
+            }
+        }
+        nodes.clear();
+    }
+
+    //pixels[p] gets the color seen along cameraRays[p]
+    void render(vector<Ray>& cameraRays, vector<point>& pixels)
+    {
+        for (int p = 0; p < cameraRays.size(); p++) {
+            QueuedRay qr = {cameraRays[p], -1, p, 1, 1.0};
+            primaryQueue.push_back(qr);
+            countRay(primaryRays, 1);
+            pixels[p] = point(0, 0, 0);
+        }
+
+        intersectAndShade(primaryQueue, reflectionQueue, refractionQueue);
+        traceShadows();
+
+        while (!reflectionQueue.empty() || !refractionQueue.empty()) {
+            intersectAndShade(reflectionQueue, nextReflectionQueue, nextRefractionQueue);
+            intersectAndShade(refractionQueue, nextReflectionQueue, nextRefractionQueue);
+            traceShadows();
+
+            reflectionQueue.swap(nextReflectionQueue);
+            refractionQueue.swap(nextRefractionQueue);
+        }
+
+        resolve(pixels);
+    }
+};
+
+#endif
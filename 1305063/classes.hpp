@@ -432,7 +432,8 @@ public:
             color[0] = color[1] = color[2] = 1;
         }
 
-        bitmap_image floorTexture("sky.bmp");
+        //read once on the first hit and kept, not on every hit
+        static bitmap_image floorTexture("sky.bmp");
         double textHeight = floorTexture.height()/width;
         double textWidth = floorTexture.width()/width;
 
@@ -367,17 +367,23 @@ public:
 
 };
 
+//bd.bmp is read once, on the first floor, and shared by all floors
+bitmap_image& floorTexture()
+{
+    static bitmap_image texture("bd.bmp");
+    return texture;
+}
+
 class Floor: public Object {
 
 public:
 
-    bitmap_image bd;
+    bitmap_image& bd;
     double bdHeight, bdWidth;
 
-    Floor(double floorWidth, double tileWidth) {
+    Floor(double floorWidth, double tileWidth) : bd(floorTexture()) {
         reference_point = Point3(-floorWidth/2, -floorWidth/2, 0);
         length = tileWidth;
-        bd = bitmap_image("bd.bmp");
         bdHeight = bd.height()/1000.0;
         bdWidth = bd.width()/1000.0;
     }
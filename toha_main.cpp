@@ -3,6 +3,7 @@
 #include<cstdlib>
 #include<cmath>
 #include<vector>
+#include<algorithm>
 #include <windows.h>
 #include <glut.h>
 using namespace std;
@@ -252,18 +253,19 @@ void capture() {
 
     cout<<pos;
 
-    Point3** frameBuffer;
+    //one contiguous rgb block kept between captures, row i starts at i*imageHeight*3.
+    //storage has 16 floats to spare so frameBuffer can start on a 64 byte boundary
+    static vector<float> storage;
+    static float* frameBuffer = 0;
+    int size = 3 * imageWidth * imageHeight;
 
-    frameBuffer = new Point3* [imageWidth];
+    if (storage.size() != size + 16) {
+        vector<float>(size + 16).swap(storage);
 
-    Point3 color(0, 0, 0);
-
-    for (int i=0; i<imageWidth; i++) {
-        frameBuffer[i] = new Point3[imageHeight];
-        for (int j=0; j<imageHeight; j++) {
-            frameBuffer[i][j] = color;
-        }
+        size_t address = reinterpret_cast<size_t>(&storage[0]);
+        frameBuffer = &storage[0] + ((64 - address % 64) % 64) / sizeof(float);
     }
+    fill(frameBuffer, frameBuffer + size, 0.0f);
 
 
 
@@ -308,9 +310,10 @@ void capture() {
 
                 double t = objects[nearest]->intersect(&ray, color, 1);
                 //cout<<i<<','<<j<<','<<t<<','<<color[0]<<','<<color[1]<<','<<color[2]<<endl;
-                frameBuffer[i][j].x = color[0];
-                frameBuffer[i][j].y = color[1];
-                frameBuffer[i][j].z = color[2];
+                float* pixel = &frameBuffer[3 * (i * imageHeight + j)];
+                pixel[0] = color[0];
+                pixel[1] = color[1];
+                pixel[2] = color[2];
 
 
             }
@@ -323,7 +326,8 @@ void capture() {
 
     for (int i=0; i<imageWidth; i++) {
         for (int j=0; j<imageHeight; j++) {
-            image.set_pixel(j, i, frameBuffer[i][j].x*255, frameBuffer[i][j].y*255, frameBuffer[i][j].z*255);
+            float* pixel = &frameBuffer[3 * (i * imageHeight + j)];
+            image.set_pixel(j, i, pixel[0]*255, pixel[1]*255, pixel[2]*255);
         }
     }
 